@@ -19,6 +19,7 @@ OBJS =  \
     float.o       	\
     function.o    	\
     heap.o		\
+    image.o		\
     libmu.o            	\
     namespace.o   	\
     print.o       	\
@@ -28,11 +29,13 @@ OBJS =  \
     symbol.o      	\
     type.o     	   	\
     vector.o		\
+    weak.o		\
     heap-mapped.o      	\
     env-context.o       \
     env-env.o           \
     env-frame.o         \
     env-namespace.o     \
+    env-weak.o          \
     mu-char.o          	\
     mu-cons.o          	\
     mu-core.o          	\
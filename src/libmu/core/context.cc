@@ -12,12 +12,14 @@
  **/
 #include "libmu/core/context.h"
 
+#include <algorithm>
 #include <cassert>
 #include <condition_variable>
 #include <functional>
 #include <iomanip>
 #include <map>
 #include <mutex>
+#include <unordered_set>
 #include <vector>
 
 #include "libmu/core/env.h"
@@ -51,8 +53,10 @@ namespace core {
 Tag Context::FrameToTag(Frame &fp) {
   int64_t asize = Fixnum::Int64Of(Function::arity(env, fp.func));
 
-  std::vector<Tag> argv(fp.argv, fp.argv + asize);
-  return Cons(fp.func, Vector(argv).Heap(env)).Heap(env);
+  Tag argv = Vector::Alloc(env, SYS_CLASS::T, asize);
+  std::copy(fp.argv, fp.argv + asize, Vector::Data<Tag>(env, argv));
+
+  return Cons(fp.func, argv).Heap(env);
 }
 
 Tag Context::FuncIdOf(Tag frame) {
@@ -77,6 +81,7 @@ void Context::SetNthArgOf(Tag frame, Tag value, int nth) {
   Tag argv = Cons::cdr(env, frame);
   assert(Vector::IsTyped(env, argv, SYS_CLASS::T));
 
+  Heap::WriteBarrier(env, argv, value);
   Vector::Data<Tag>(env, argv)[nth] = value;
 }
 
@@ -125,22 +130,58 @@ Tag Context::CaptureContext() {
   return Cons::List(env, context);
 }
 
-void Context::GcFrame(Env &env, Frame &fp) {
-  Env::Gc(env, fp.func);
-
+void Context::GcFrame(Frame &fp, const std::function<void(Tag &)> &fn) {
   int64_t nargs = Fixnum::Int64Of(Function::arity(env, fp.func));
+
   for (int i = 0; i < nargs; ++i)
-    Env::Gc(env, fp.argv[i]);
+    fn(fp.argv[i]);
+
+  fn(fp.func);
+  fn(fp.value);
 }
 
-void Context::GcContext() {
-#if 0
-    fp->env.GcMark(fp->func);
+void Context::GcContext(const std::function<void(Tag &)> &fn) {
 
-    int64_t nargs = Fixnum::Int64Of(Function::arity(fp->env, fp->func));
-    for (int64_t i = 0; i < nargs; ++i)
-      fp->env.GcMark(fp->argv[i]);
-#endif
+  for (auto fp : dynamic)
+    GcFrame(*fp, fn);
+
+  /* closure frame arguments live in the frame vector */
+  std::unordered_map<Tag, std::vector<Frame *>> closures_{};
+  for (auto &[frame, frames] : closures) {
+    if (frames.empty())
+      continue;
+
+    Tag key = frame;
+
+    GcFrame(*frames.back(), fn);
+    fn(key);
+    closures_[key] = std::move(frames);
+  }
+  closures.swap(closures_);
+
+  /* a root passed to Funcall is also its frame's argv, visit it once */
+  std::unordered_set<Tag *> argvs{};
+  for (auto fp : dynamic)
+    argvs.insert(fp->argv);
+
+  for (auto tags : roots)
+    if (!argvs.contains(tags->data()))
+      for (auto &tag : *tags)
+        fn(tag);
+}
+
+/** * rebind closure frames to their (possibly moved) frame vectors **/
+void Context::GcFixup() {
+
+  for (auto &[frame, frames] : closures) {
+    Tag func = Cons::car(env, frame);
+    Tag argv = Cons::cdr(env, frame);
+
+    for (auto fp : frames) {
+      fp->func = func;
+      fp->argv = Vector::Data<Tag>(env, argv);
+    }
+  }
 }
 
 /** * constructors **/
@@ -148,6 +189,12 @@ Context::Context(Env &env, Tag ctx) : env(env) {
   Tag dynamic_ = Cons::Nth(env, ctx, 0);
   Tag lexical_ = Cons::Nth(env, ctx, 1);
 
+  env.contexts.push_back(this);
+
+  /* the constructing thread allocates through this context's buffer */
+  env.heap->AttachBuffer(alloc_buffer);
+  Heap::alloc_buffer = &alloc_buffer;
+
   if (Type::Null(ctx))
     return;
 
@@ -170,5 +217,14 @@ Context::Context(Env &env, Tag ctx) : env(env) {
   }
 }
 
+Context::~Context() {
+
+  if (Heap::alloc_buffer == &alloc_buffer)
+    Heap::alloc_buffer = nullptr;
+
+  env.heap->DetachBuffer(alloc_buffer);
+  std::erase(env.contexts, this);
+}
+
 } /* namespace core */
 } /* namespace libmu */
@@ -16,13 +16,16 @@
 #include <cassert>
 #include <condition_variable>
 #include <csetjmp>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <optional>
 #include <stack>
 #include <thread>
 #include <unordered_map>
+#include <vector>
 
+#include "libmu/core/heap.h"
 #include "libmu/core/type.h"
 
 #include "libmu/type/fixnum.h"
@@ -106,8 +109,20 @@ public:
   Frame *TagToFrame(Tag);
   Tag CaptureContext();
 
-  void GcFrame(Env &, Frame &);
-  void GcContext();
+  void GcFrame(Frame &, const std::function<void(Tag &)> &);
+  void GcContext(const std::function<void(Tag &)> &);
+  void GcFixup();
+
+  /** * C++ tag vectors held across evaluation are gc roots **/
+  struct GcRoot {
+    Context &ctx;
+
+    GcRoot(Context &ctx, std::vector<Tag> &tags) : ctx(ctx) {
+      ctx.roots.push_back(&tags);
+    }
+
+    ~GcRoot() { ctx.roots.pop_back(); }
+  };
 
 public:
   /* global environment */
@@ -124,11 +139,15 @@ public:
   std::vector<Frame *> dynamic;                           /* control stack */
   std::unordered_map<Tag, std::vector<Frame *>> lexical;  /* lexical bindings */
   std::unordered_map<Tag, std::vector<Frame *>> closures; /* closure bindings */
+  std::vector<std::vector<Tag> *> roots;                  /* C++ held tags */
 
   StackInfo stack_info{0, 0, 0}; /* control stack monitoring */
 
+  Heap::AllocBuffer alloc_buffer{}; /* nursery allocation buffer */
+
 public:
   explicit Context(Env &, Tag);
+  ~Context();
 }; /* struct Context */
 
 } /* namespace core */
@@ -130,7 +130,9 @@ static const std::vector<Env::MuFunctionDef> kMuIntFuncTab{
 
 /** * env extern functions **/
 static const std::vector<Env::MuFunctionDef> kEnvExtFuncTab{
+    {"arena", env::WithArena, 1},
     {"bind", env::BindContext, 2},
+    {"ckpt", env::Checkpoint, 0},
     {"context", env::GetContext, 0},
     {"cx-info", env::ContextInfo, 0},
     {"ev-info", env::EnvInfo, 0},
@@ -138,7 +140,7 @@ static const std::vector<Env::MuFunctionDef> kEnvExtFuncTab{
     {"fix", env::ContextFix, 1},
     {"fnv-lex", env::FrameGet, 1},
     {"fnv-set", env::FrameSetVar, 3},
-    {"gc", env::Gc, 0},
+    {"gc", env::Gc, 1},
     {"hp-info", env::HeapInfo, 2},
     {"lex-pop", env::FramePop, 1},
     {"lex-psh", env::FramePush, 1},
@@ -147,7 +149,12 @@ static const std::vector<Env::MuFunctionDef> kEnvExtFuncTab{
     {"ns", env::Namespace, 1},
     {"resume", env::ResumeContext, 1},
     {"saveimg", env::SaveImage, 1},
+    {"static", env::Promote, 0},
     {"suspend", env::SuspendContext, 2},
+    {"weak", env::MakeWeak, 2},
+    {"wk-key", env::WeakKey, 1},
+    {"wk-live", env::WeakLive, 1},
+    {"wk-val", env::WeakValue, 1},
 };
 
 /** * env intern functions **/
@@ -182,6 +189,23 @@ void bind_functions(Env &env, Tag ns, SCOPE scope,
   }
 }
 
+/** * rebind native functions mapped in from an image **/
+void rebind_functions(Env &env, Tag ns, SCOPE scope,
+                      const std::vector<Env::MuFunctionDef> &fns) {
+
+  for (auto &el : fns) {
+    auto sym = Namespace::Map(env, ns, scope, Vector(el.name).Heap(env));
+    if (!sym.has_value())
+      throw std::runtime_error("image: unbound native function");
+
+    Tag fn = Symbol::value(env, sym.value());
+    if (!Function::IsType(fn) || !Function::IsNative(env, fn))
+      throw std::runtime_error("image: unbound native function");
+
+    env.fn_cache->insert({Function::form(env, fn), el.fn});
+  }
+}
+
 } /* anonymous namespace */
 
 /** look up namespace by name in environment map **/
@@ -202,39 +226,62 @@ void Env::AddNamespace(Tag ns) {
   auto ns_iter = namespaces.find(ns_name);
 
   if (ns_iter == namespaces.end()) {
+    Heap::Escape(*this, Type::NIL, ns);
     namespaces[ns_name] = ns;
     ns_cache->add_ns_cache(ns);
   }
 }
 
 /** * garbage collection **/
-void Env::Gc(Env &env, Tag ptr) {
-
-  std::function<void(Env &, Tag)> noGc = [](Env &, Tag) {};
-  static const std::map<SYS_CLASS, std::function<void(Env &, Tag)>> kGcTypeMap{
-      {SYS_CLASS::CHAR, noGc},
-      {SYS_CLASS::CONS, type::Cons::Gc},
-      {SYS_CLASS::DOUBLE, noGc},
-      {SYS_CLASS::EXCEPTION, type::Exception::Gc},
-      {SYS_CLASS::FIXNUM, noGc},
-      {SYS_CLASS::FLOAT, noGc},
-      {SYS_CLASS::FUNCTION, type::Function::Gc},
-      {SYS_CLASS::NAMESPACE, type::Namespace::Gc},
-      {SYS_CLASS::STREAM, noGc},
-      {SYS_CLASS::SYMBOL, type::Symbol::Gc},
-      {SYS_CLASS::VECTOR, type::Vector::Gc}};
-
-  assert(kGcTypeMap.contains(Type::TypeOf(ptr)));
-  kGcTypeMap.at(Type::TypeOf(ptr))(env, ptr);
+void Env::Gc(Env &env, Tag ptr) { Heap::GcMark(env, ptr); }
+
+/** * visit the environment's roots **/
+void Env::GcRoots(const std::function<void(Tag &)> &fn) {
+
+  for (auto &[name, ns] : namespaces)
+    fn(ns);
+
+  fn(version);
+  fn(env);
+  fn(mu);
+  fn(uninterned);
+  fn(system);
+  fn(standard_input);
+  fn(standard_output);
+  fn(error_output);
+
+  for (auto &symbol : compiler->lexicals)
+    fn(symbol);
+
+  FnCache fns{};
+  for (auto &[symbol, mufn] : *fn_cache) {
+    Tag key = symbol;
+
+    fn(key);
+    fns.insert({key, mufn});
+  }
+  fn_cache->swap(fns);
+
+  ns_cache->GcRoots(fn);
+  heap->GcRoots(fn);
+
+  for (auto ctx : contexts)
+    ctx->GcContext(fn);
+}
+
+/** * repair C++ state derived from moved objects **/
+void Env::GcFixup() {
+
+  for (auto ctx : contexts)
+    ctx->GcFixup();
 }
 
 /** * env constructor **/
-Env::Env(system::System &env_sys) : sys(env_sys) {
+Env::Env(system::System &env_sys, size_t heap_pages)
+    : sys(env_sys), heap_fd(-1), heap_generation(0), heap_ceiling(0) {
   Env &_env = *this;
 
-  // need to get number of pages from command line or process env;
-  // -= runtime configuration needs thought =-
-  heap = std::make_unique<heap::Mapped>(env_sys, 1024);
+  heap = std::make_unique<heap::Mapped>(env_sys, heap_pages);
 
   readtable = std::make_unique<ReadTable>();
   compiler = std::make_unique<Compile>();
@@ -280,6 +327,38 @@ Env::Env(system::System &env_sys) : sys(env_sys) {
   bind_functions(_env, mu, SCOPE::INTERN, kMuIntFuncTab);
   bind_functions(_env, system, SCOPE::EXTERN, kSystemExtFuncTab);
   bind_functions(_env, system, SCOPE::INTERN, kSystemIntFuncTab);
+
+  /* bootstrap objects live as long as the environment */
+  Heap::GcPromote(_env);
+}
+
+/** * env constructor, from an image **/
+Env::Env(system::System &env_sys, size_t heap_pages, const std::string &image)
+    : sys(env_sys), heap_fd(-1), heap_generation(0), heap_ceiling(0) {
+
+  heap = std::make_unique<heap::Mapped>(env_sys, heap_pages);
+
+  readtable = std::make_unique<ReadTable>();
+  compiler = std::make_unique<Compile>();
+  ns_cache = std::make_unique<NSCache>();
+  fn_cache = std::make_unique<FnCache>();
+
+  if (!MapImage(image))
+    throw std::runtime_error("image: can't map " + image);
+
+  RebindFunctions();
+}
+
+/** * native functions live outside the heap, bind them again **/
+void Env::RebindFunctions() {
+  Env &_env = *this;
+
+  rebind_functions(_env, env, SCOPE::EXTERN, kEnvExtFuncTab);
+  rebind_functions(_env, env, SCOPE::INTERN, kEnvIntFuncTab);
+  rebind_functions(_env, mu, SCOPE::EXTERN, kMuExtFuncTab);
+  rebind_functions(_env, mu, SCOPE::INTERN, kMuIntFuncTab);
+  rebind_functions(_env, system, SCOPE::EXTERN, kSystemExtFuncTab);
+  rebind_functions(_env, system, SCOPE::INTERN, kSystemIntFuncTab);
 }
 
 } /* namespace core */
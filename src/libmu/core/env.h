@@ -14,9 +14,12 @@
 #define LIBMU_CORE_ENV_H_
 
 #include <cassert>
+#include <functional>
 #include <memory>
 #include <stack>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "libmu/core/compile.h"
 #include "libmu/core/context.h"
@@ -71,13 +74,25 @@ public: /* mu function definition */
   void AddNamespace(Tag);
 
   /** * garbage collection **/
-  static bool IsGcMarked(Env &env, Tag ptr) {
-    return env.heap->IsGcMarked(env, ptr);
-  }
+  static void Gc(Env &, Tag);
 
-  static void GcMark(Env &env, Tag ptr) { env.heap->GcMark(env, ptr); }
+  void GcRoots(const std::function<void(Tag &)> &);
+  void GcFixup();
 
-  static void Gc(Env &, Tag);
+  /** * images **/
+  static const uint32_t IMAGE_FORMAT = 4;
+
+  bool SaveImage(const std::string &);
+  bool MapImage(const std::string &);
+
+  /** * persistent heaps **/
+  bool OpenHeap(const std::string &);
+  bool Checkpoint();
+
+private:
+  bool SaveImage(int, bool);
+  bool MapImage(int, bool);
+  void RebindFunctions();
 
 public:
   std::unique_ptr<Compile> compiler;    /* compiler env */
@@ -100,10 +115,17 @@ public:
   Tag standard_output; /* standard-output */
   Tag error_output;    /* error-output */
 
+  std::vector<Context *> contexts; /* execution contexts */
+
   system::System &sys; /* system interface */
 
+  int heap_fd;              /* persistent heap file, or -1 */
+  uint64_t heap_generation; /* last checkpoint's generation */
+  uint64_t heap_ceiling;    /* heap file's heap pages */
+
 public: /* object */
-  explicit Env(system::System &);
+  explicit Env(system::System &, size_t);
+  explicit Env(system::System &, size_t, const std::string &);
 
 }; /* struct Env */
 
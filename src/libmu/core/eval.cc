@@ -15,6 +15,7 @@
 #include <functional>
 #include <iomanip>
 #include <map>
+#include <optional>
 #include <unordered_map>
 #include <vector>
 
@@ -49,6 +50,29 @@ namespace core {
 
 using Frame = Context::Frame;
 
+namespace {
+
+/** * frame bindings, popped on return or unwind **/
+struct FrameScope {
+  Context &ctx;
+  std::optional<Tag> frame_id;
+
+  FrameScope(Context &ctx, Frame &fp, std::optional<Tag> frame_id)
+      : ctx(ctx), frame_id(frame_id) {
+    ctx.DynamicContextPush(fp);
+    if (frame_id.has_value())
+      ctx.LexicalContextPush(frame_id.value(), fp);
+  }
+
+  ~FrameScope() {
+    if (frame_id.has_value())
+      ctx.LexicalContextPop(frame_id.value());
+    ctx.DynamicContextPop();
+  }
+};
+
+} /* anonymous namespace */
+
 /** * call function with argument vector **/
 Tag Env::Funcall(Context &ctx, Tag func, const std::vector<Tag> &argv) {
   assert(Function::IsType(func));
@@ -67,31 +91,24 @@ Tag Env::Funcall(Context &ctx, Tag func, const std::vector<Tag> &argv) {
   Tag fn = Function::form(env, func);
 
   if (Symbol::IsType(fn)) {
-    ctx.DynamicContextPush(fp);
-    env.fn_cache->at(fn)(ctx, fp);
-    ctx.DynamicContextPop();
+    FrameScope scope(ctx, fp, std::nullopt);
 
+    env.fn_cache->at(fn)(ctx, fp);
     return fp.value;
   }
 
   if (!Cons::IsType(fn))
     throw std::runtime_error("funcall type");
 
-  ctx.DynamicContextPush(fp);
-
-  if (nreqs)
-    ctx.LexicalContextPush(Function::frame_id(env, func), fp);
+  FrameScope scope(ctx, fp,
+                   nreqs ? std::optional<Tag>{Function::frame_id(env, func)}
+                         : std::nullopt);
 
   fp.value = Cons::cdr(env, fn);
   Cons::iter iter(env, fp.value);
   for (auto it = iter.begin(); it != iter.end(); it = ++iter)
     fp.value = Eval(ctx, Cons::car(env, it));
 
-  if (nreqs)
-    ctx.LexicalContextPop(Function::frame_id(env, func));
-
-  ctx.DynamicContextPop();
-
   return fp.value;
 }
 
@@ -99,6 +116,9 @@ Tag Env::Funcall(Context &ctx, Tag func, const std::vector<Tag> &argv) {
 Tag Env::Eval(Context &ctx, Tag form) {
   Env &env = ctx.env;
 
+  if (env.heap->gc_pending)
+    Heap::GcSafePoint(env);
+
   if (Symbol::IsType(form)) {
     if (!Symbol::IsBound(env, form))
       Exception::Raise(env, "eval", "error", "unbound", form);
@@ -136,6 +156,8 @@ Tag Env::Eval(Context &ctx, Tag form) {
   Tag args = Cons::cdr(env, form);
 
   std::vector<Tag> vlist{};
+  Context::GcRoot root(ctx, vlist);
+
   if (!Type::Null(args)) {
     vlist.reserve(Cons::Length(env, args));
 
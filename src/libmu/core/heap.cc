@@ -12,7 +12,9 @@
  **/
 #include <cassert>
 #include <cinttypes>
+#include <cstring>
 #include <functional>
+#include <limits>
 #include <map>
 #include <optional>
 #include <string>
@@ -33,8 +35,15 @@
 #include "libmu/type/stream.h"
 #include "libmu/type/symbol.h"
 #include "libmu/type/vector.h"
+#include "libmu/type/weak.h"
 
 namespace libmu {
+
+using Cons = type::Cons;
+using Fixnum = type::Fixnum;
+using Vector = type::Vector;
+using Weak = type::Weak;
+
 namespace core {
 
 /** * convert tag to uint64_t **/
@@ -43,46 +52,734 @@ void *Heap::LayoutAddr(Env &env, Tag ptr) {
   return env.heap->HeapAddr(Type::IndirectData(ptr));
 }
 
+namespace {
+
+/** * report a word on the stack if it references a heap object **/
+void conservative(Env &env, uint64_t word,
+                  const std::function<void(Heap::HeapInfo *)> &fn) {
+  Heap &heap = *env.heap;
+
+  std::function<void(Tag)> tagged = [&heap, &fn](Tag ptr) {
+    if (Type::TagOf(ptr) != Type::TAG::INDIRECT)
+      return;
+
+    Heap::HeapInfo *hinfo = heap.Map(ptr);
+    if (!heap.IsObject(hinfo))
+      return;
+
+    /* a page's header isn't an object */
+    Heap::HeapInfo *header = heap.HeaderOf(hinfo);
+    if (header == hinfo && Heap::RefBits(*hinfo) & Heap::GC_PAGE)
+      return;
+
+    if (Heap::SysClass(*header) == Type::IndirectClass(ptr))
+      fn(hinfo);
+  };
+
+  Tag ptr = Tag(word);
+
+  switch (Type::TagOf(ptr)) {
+  case Type::TAG::INDIRECT:
+    tagged(ptr);
+    break;
+  case Type::TAG::CONS:
+    tagged(Cons::car(env, ptr));
+    tagged(Cons::cdr(env, ptr));
+    break;
+  default:
+    break;
+  }
+
+  /* raw pointers into heap objects */
+  std::optional<Heap::HeapInfo *> interior = heap.MapInterior(word);
+  if (interior.has_value())
+    fn(interior.value());
+
+  /* and into large vector data */
+  heap.MarkLarge(word);
+}
+
+/** * scan the stack between here and the stack base **/
+__attribute__((noinline, no_sanitize("address"))) void
+scan_stack(Env &env, const std::function<void(Heap::HeapInfo *)> &fn) {
+  static thread_local const char *base = nullptr;
+  uint64_t marker = 0;
+
+  if (base == nullptr) {
+    std::optional<const char *> stack_base = system::System::StackBase();
+    if (!stack_base.has_value())
+      throw std::runtime_error("stack base botch");
+
+    base = stack_base.value();
+  }
+
+  for (auto sp = &marker; sp < reinterpret_cast<const uint64_t *>(base); ++sp)
+    conservative(env, *sp, fn);
+}
+
+} /* anonymous namespace */
+
 /** * garbage collection **/
-void Heap::Gc(Env &env) {
+void Heap::Gc(Env &env, bool compact) {
+  Heap &heap = *env.heap;
+
+  if (compact || heap.OldRoom() < heap.NurseryAlloc() ||
+      heap.gc_tenured > heap.OldRoom() / 2)
+    GcFull(env, compact);
+  else
+    GcMinor(env);
+}
+
+/** * collect if the allocator asked for it. only the evaluator calls
+ ** this, where everything live is rooted or on this thread's stack.
+ ** other threads' stacks aren't scanned, so a lone context only. **/
+void Heap::GcSafePoint(Env &env) {
+
+  if (env.contexts.size() > 1)
+    return;
+
+  Gc(env, false);
+}
+
+/** * collect the nursery, promoting survivors to the old generation **/
+void Heap::GcMinor(Env &env) {
+  Heap &heap = *env.heap;
+
+  /* conservative references pin their nursery referents in place */
+  GcStack(env, [&heap](HeapInfo *hinfo) {
+    if (heap.IsNursery(hinfo) && !(RefBits(*hinfo) & GC_PIN)) {
+      *hinfo = RefBits(*hinfo, RefBits(*hinfo) | GC_PIN);
+      heap.pinned.push_back(hinfo);
+      heap.scavenged.push_back(hinfo);
+    }
+  });
+
+  env.GcRoots([&env](Tag &ptr) { ptr = GcForward(env, ptr); });
+
+  std::vector<HeapInfo *> remembered{};
+  remembered.swap(heap.remembered);
+
+  for (auto hinfo : remembered) {
+    *hinfo = RefBits(*hinfo, RefBits(*hinfo) & ~GC_REMEMBER);
+    heap.scavenged.push_back(hinfo);
+  }
+
+  while (!heap.scavenged.empty()) {
+    HeapInfo *hinfo = heap.scavenged.back();
+    bool young = false;
+
+    heap.scavenged.pop_back();
+    GcSlots(env, hinfo, [&env, &young](Tag &ptr) {
+      ptr = GcForward(env, ptr);
+      young = young || IsYoung(env, ptr);
+    });
+
+    /* promoted objects may still reference pinned ones */
+    HeapInfo *header = heap.HeaderOf(hinfo);
+    if (young && !heap.IsNursery(hinfo) &&
+        !(RefBits(*header) & GC_REMEMBER)) {
+      *header = RefBits(*header, RefBits(*header) | GC_REMEMBER);
+      heap.remembered.push_back(header);
+    }
+  }
+
+  /* interned strings are weak, forget the ones that didn't survive */
+  heap.MapInterned([&heap](Tag str) -> std::optional<Tag> {
+    HeapInfo *hinfo = heap.Map(str);
 
-  env.heap->free_lists.clear();
-  env.heap->Map([](HeapInfo *it) { *it = RefBits(*it, 0); });
+    if (!heap.IsNursery(hinfo) || RefBits(*hinfo) & GC_PIN)
+      return str;
+
+    if (!(RefBits(*hinfo) & GC_FORWARD))
+      return std::nullopt;
+
+    auto forward = reinterpret_cast<HeapInfo *>(
+        heap.HeapAddr(-static_cast<int64_t>(Reloc(*hinfo))));
+
+    return Type::Entag(heap.HeapInfoTag(forward), Type::IndirectClass(str),
+                       Type::TAG::INDIRECT);
+  });
+
+  env.GcFixup();
+  heap.ResetNursery();
+
+  heap.gc_pending = false;
 }
 
+/** * collect both generations **/
+void Heap::GcFull(Env &env, bool compact) {
+  Heap &heap = *env.heap;
+
+  if (heap.OldRoom() >= heap.NurseryAlloc())
+    GcMinor(env);
+
+  GcIdle(env);
+  compact = compact || heap.IsFragmented();
+
+  heap.ClearMarks();
+
+  /* the base is immortal and isn't traced, only what it references */
+  std::erase_if(heap.base_remembered, [&env](HeapInfo *hinfo) {
+    bool dynamic = false;
+
+    GcSlots(env, hinfo, [&env, &dynamic](Tag &ptr) {
+      GcMark(env, ptr);
+      dynamic = dynamic || IsDynamic(env, ptr);
+    });
+
+    if (!dynamic)
+      *hinfo = RefBits(*hinfo, RefBits(*hinfo) & ~GC_BASEREF);
+
+    return !dynamic;
+  });
+
+  /* conservative references can't be moved, the base and pages never are */
+  GcStack(env, [&env, compact](HeapInfo *hinfo) {
+    HeapInfo *header = env.heap->HeaderOf(hinfo);
+
+    if (compact && !env.heap->IsBase(hinfo) && header == hinfo)
+      *hinfo = RefBits(*hinfo, RefBits(*hinfo) | GC_PIN);
+
+    GcMark(env, Type::Entag(env.heap->HeapInfoTag(hinfo), SysClass(*header),
+                            Type::TAG::INDIRECT));
+  });
+
+  env.GcRoots([&env](Tag &ptr) { GcMark(env, ptr); });
+
+  GcEphemerons(env);
+
+  heap.MapInterned([&env](Tag str) -> std::optional<Tag> {
+    if (!IsGcMarked(env, str))
+      return std::nullopt;
+
+    return str;
+  });
+
+  if (compact)
+    GcCompact(env);
+  else
+    GcSweep(env);
+
+  /* without room to evacuate the nursery every allocation would collect
+     again, grow instead */
+  if (heap.OldRoom() < heap.NurseryAlloc())
+    heap.Grow(heap.NurseryAlloc() - heap.OldRoom());
+
+  heap.gc_tenured = 0;
+  heap.gc_pending = false;
+}
+
+/** * slide the live old generation down over the dead **/
+void Heap::GcCompact(Env &env) {
+  Heap &heap = *env.heap;
+
+  std::erase_if(heap.remembered, [&heap](HeapInfo *hinfo) {
+    return !heap.IsBase(hinfo) && !heap.IsMarked(hinfo);
+  });
+
+  /* relocs are planned, rewrite every reference before anything moves */
+  heap.Compact([&env, &heap]() {
+    auto relocate = [&env](HeapInfo *hinfo) {
+      GcSlots(env, hinfo, [&env](Tag &ptr) {
+        Tag moved = GcRelocate(env, ptr);
+
+        /* don't dirty shared base pages with unchanged stores */
+        if (!Type::Eq(moved, ptr))
+          ptr = moved;
+      });
+    };
+
+    /* the rest of the base only references the base */
+    heap.MapDynamic(relocate);
+    for (auto hinfo : heap.base_remembered)
+      relocate(hinfo);
+
+    heap.MapInterned([&env](Tag str) { return GcRelocate(env, str); });
+
+    /* closure frames point into vector data, relocate those once */
+    env.GcRoots([&env, &heap](Tag &ptr) {
+      if (!heap.IsHeapAddr(&ptr))
+        ptr = GcRelocate(env, ptr);
+    });
+
+    for (auto &hinfo : heap.remembered)
+      if (!heap.IsBase(hinfo))
+        hinfo = reinterpret_cast<HeapInfo *>(
+            heap.HeapAddr(-static_cast<int64_t>(Reloc(*hinfo))));
+  });
+
+  heap.SweepLarge();
+
+  env.GcFixup();
+  heap.ResetNursery();
+}
+
+/** * where a compacted tag's object went **/
+Tag Heap::GcRelocate(Env &env, Tag ptr) {
+  Heap &heap = *env.heap;
+
+  switch (Type::TagOf(ptr)) {
+  case Type::TAG::CONS: {
+    /* moving down only shrinks offsets, it still packs */
+    std::optional<Tag> immediate =
+        Cons::Immediate(GcRelocate(env, Cons::car(env, ptr)),
+                        GcRelocate(env, Cons::cdr(env, ptr)));
+
+    assert(immediate.has_value());
+    return immediate.value();
+  }
+  case Type::TAG::INDIRECT: {
+    HeapInfo *hinfo = heap.Map(ptr);
+
+    if (heap.IsNursery(hinfo) || heap.IsBase(hinfo) ||
+        heap.HeaderOf(hinfo) != hinfo)
+      return ptr;
+
+    auto forward = reinterpret_cast<HeapInfo *>(
+        heap.HeapAddr(-static_cast<int64_t>(Reloc(*hinfo))));
+
+    return Type::Entag(heap.HeapInfoTag(forward), Type::IndirectClass(ptr),
+                       Type::TAG::INDIRECT);
+  }
+  default:
+    return ptr;
+  }
+}
+
+/** * mark everything reachable from a tag **/
 void Heap::GcMark(Env &env, Tag ptr) {
-  HeapInfo *hinfo = env.heap->Map(ptr);
+  Heap &heap = *env.heap;
+
+  GcGray(env, ptr);
+
+  for (;;) {
+    while (!heap.mark_stack.empty()) {
+      HeapInfo *hinfo = heap.mark_stack.back();
+
+      heap.mark_stack.pop_back();
+      GcScan(env, hinfo);
+    }
+
+    if (!heap.mark_overflow)
+      break;
+
+    /* the stack overflowed, rescan marked objects for unmarked children */
+    std::function<void(HeapInfo *)> rescan = [&env, &heap](HeapInfo *hinfo) {
+      if (heap.IsMarked(hinfo)) {
+        GcScan(env, hinfo);
+        while (!heap.mark_stack.empty()) {
+          HeapInfo *gray = heap.mark_stack.back();
+
+          heap.mark_stack.pop_back();
+          GcScan(env, gray);
+        }
+      }
+    };
+
+    heap.mark_overflow = false;
+    heap.Map([&heap, &rescan](HeapInfo *hinfo) {
+      if (RefBits(*hinfo) & GC_PAGE)
+        heap.MapPage(hinfo, rescan);
+      else
+        rescan(hinfo);
+    });
+  }
+}
+
+/** * mark a tag's object and queue it for scanning **/
+void Heap::GcGray(Env &env, Tag ptr) {
+  Heap &heap = *env.heap;
+
+  switch (Type::TagOf(ptr)) {
+  case Type::TAG::CONS: /* immediate cons elements are never conses */
+    GcGray(env, Cons::car(env, ptr));
+    GcGray(env, Cons::cdr(env, ptr));
+    break;
+  case Type::TAG::INDIRECT: {
+    HeapInfo *hinfo = heap.Map(ptr);
+
+    if (heap.IsBase(hinfo) || !heap.Mark(hinfo))
+      return;
 
-  *hinfo = RefBits(*hinfo, 1);
+    /* large vector data lives and dies with its vector */
+    if (Type::IndirectClass(ptr) == Type::SYS_CLASS::VECTOR)
+      heap.MarkLarge(reinterpret_cast<uint64_t>(heap.HeapAddr(Fixnum::Int64Of(
+          reinterpret_cast<Vector::Layout *>(hinfo + 1)->offset))));
+
+    switch (Type::IndirectClass(ptr)) {
+    case Type::SYS_CLASS::DOUBLE:
+    case Type::SYS_CLASS::STREAM:
+      break;
+    default:
+      if (heap.mark_stack.size() < MARK_STACK_MAX)
+        heap.mark_stack.push_back(hinfo);
+      else
+        heap.mark_overflow = true;
+      break;
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/** * gray a marked object's children, iterating down cdr chains **/
+void Heap::GcScan(Env &env, HeapInfo *hinfo) {
+  Heap &heap = *env.heap;
+  Type::SYS_CLASS sys_class = SysClass(*heap.HeaderOf(hinfo));
+
+  while (sys_class == Type::SYS_CLASS::CONS) {
+    auto cons = reinterpret_cast<Cons::Layout *>(hinfo + 1);
+    Tag cdr = cons->cdr;
+
+    GcGray(env, cons->car);
+
+    if (!Type::IsIndirect(cdr) ||
+        Type::IndirectClass(cdr) != Type::SYS_CLASS::CONS) {
+      GcGray(env, cdr);
+      return;
+    }
+
+    hinfo = heap.Map(cdr);
+    if (!heap.Mark(hinfo))
+      return;
+  }
+
+  /* ephemerons wait until it's known whether their keys are reachable */
+  if (sys_class == Type::SYS_CLASS::WEAK) {
+    heap.ephemerons.push_back(hinfo);
+    return;
+  }
+
+  GcSlots(env, hinfo, [&env](Tag &ptr) { GcGray(env, ptr); });
+}
+
+/** * is a tag's object marked, anything not in the heap always is **/
+bool Heap::IsGcLive(Env &env, Tag ptr) {
+
+  switch (Type::TagOf(ptr)) {
+  case Type::TAG::CONS:
+    return IsGcLive(env, Cons::car(env, ptr)) &&
+           IsGcLive(env, Cons::cdr(env, ptr));
+  case Type::TAG::INDIRECT:
+    return IsGcMarked(env, ptr);
+  default:
+    return true;
+  }
+}
+
+/** * mark the values of ephemerons with reachable keys until no more
+ ** keys become reachable, then break the rest **/
+void Heap::GcEphemerons(Env &env) {
+  Heap &heap = *env.heap;
+
+  for (bool marked = true; marked;) {
+    std::vector<HeapInfo *> pending{};
+
+    marked = false;
+    pending.swap(heap.ephemerons);
+    for (auto hinfo : pending) {
+      auto weak = reinterpret_cast<Weak::Layout *>(hinfo + 1);
+
+      if (!IsGcLive(env, weak->key)) {
+        heap.ephemerons.push_back(hinfo);
+        continue;
+      }
+
+      GcMark(env, weak->value);
+      marked = true;
+    }
+  }
+
+  for (auto hinfo : heap.ephemerons)
+    *reinterpret_cast<Weak::Layout *>(hinfo + 1) =
+        Weak::Layout{Type::NIL, Type::NIL, Type::NIL};
+
+  heap.ephemerons.clear();
 }
 
 void Heap::GcSweep(Env &env) {
+  Heap &heap = *env.heap;
 
-  env.heap->Map([&env](HeapInfo *it) {
-    if (RefBits(*it) == 0)
-      env.heap->free_lists[SysClass(*it)].push_back(it);
+  heap.Sweep();
+  heap.SweepLarge();
+
+  /* dead objects linger until swept, don't scan them */
+  std::erase_if(heap.remembered, [&heap](HeapInfo *hinfo) {
+    return !heap.IsBase(hinfo) && !heap.IsMarked(hinfo);
   });
+
+  heap.ResetNursery();
+}
+
+/** * finish any deferred sweeping **/
+void Heap::GcIdle(Env &env) {
+  Heap &heap = *env.heap;
+
+  heap.Sweep(std::numeric_limits<size_t>::max());
 }
 
 bool Heap::IsGcMarked(Env &env, Type::Tag ptr) {
   HeapInfo *hinfo = env.heap->Map(ptr);
 
-  return RefBits(*hinfo) == 0 ? false : true;
+  return env.heap->IsBase(hinfo) || env.heap->IsMarked(hinfo);
+}
+
+/** * promote the old generation into the base, returns the base's size **/
+size_t Heap::GcPromote(Env &env) {
+
+  GcFull(env, true);
+
+  size_t nbytes = env.heap->Promote();
+  GcBase(env);
+
+  return nbytes;
+}
+
+/** * find the base objects referencing the dynamic heap **/
+void Heap::GcBase(Env &env) {
+  Heap &heap = *env.heap;
+
+  heap.base_remembered.clear();
+  heap.MapBase([&env, &heap](HeapInfo *hinfo) {
+    bool dynamic = false;
+
+    GcSlots(env, hinfo, [&env, &dynamic](Tag &ptr) {
+      dynamic = dynamic || IsDynamic(env, ptr);
+    });
+
+    uint8_t refbits = dynamic ? RefBits(*hinfo) | GC_BASEREF
+                              : RefBits(*hinfo) & ~GC_BASEREF;
+
+    /* an image's base pages stay shared unless this changes them */
+    if (refbits != RefBits(*hinfo))
+      *hinfo = RefBits(*hinfo, refbits);
+
+    if (dynamic)
+      heap.base_remembered.push_back(hinfo);
+  });
 }
 
-std::optional<int> Heap::GcAlloc(Env &env, int size,
-                                 Type::SYS_CLASS sys_class) {
+/** * conservatively scan the calling thread's stack and registers **/
+void Heap::GcStack(Env &env, const std::function<void(HeapInfo *)> &fn) {
+
+  /* spill callee-saved registers into this frame */
+  __builtin_unwind_init();
+  scan_stack(env, fn);
+}
 
-  if (env.heap->free_lists.contains(sys_class) &&
-      env.heap->free_lists[sys_class].size()) {
-    HeapInfo *free = env.heap->free_lists[sys_class].back();
+/** * visit the tagged slots of a heap object **/
+void Heap::GcSlots(Env &env, HeapInfo *hinfo,
+                   const std::function<void(Tag &)> &fn) {
+  Heap &heap = *env.heap;
+  HeapInfo *header = heap.HeaderOf(hinfo);
+  Tag *slots = reinterpret_cast<Tag *>(hinfo + 1);
 
-    env.heap->free_lists[sys_class].pop_back();
-    return env.heap->HeapInfoTag(free);
+  /* paged objects are all tags, a page's header stands for them all */
+  if (RefBits(*header) & GC_PAGE) {
+    if (header == hinfo)
+      heap.MapPage(hinfo, [&env, &fn](HeapInfo *object) {
+        GcSlots(env, object, fn);
+      });
+    else
+      for (size_t i = 0; i < PageObjectSize(header) / sizeof(Tag); ++i)
+        fn(slots[i]);
+
+    return;
   }
 
+  switch (SysClass(*hinfo)) {
+  case Type::SYS_CLASS::CONS:
+  case Type::SYS_CLASS::EXCEPTION:
+  case Type::SYS_CLASS::FUNCTION:
+  case Type::SYS_CLASS::NAMESPACE:
+  case Type::SYS_CLASS::SYMBOL:
+    [[fallthrough]];
+  case Type::SYS_CLASS::WEAK:
+    for (size_t i = 0; i < Size(*hinfo) / sizeof(Tag) - 1; ++i)
+      fn(slots[i]);
+    break;
+  case Type::SYS_CLASS::VECTOR: {
+    auto layout = reinterpret_cast<Vector::Layout *>(slots);
+
+    if (Type::MapSymbolClass(layout->type) == Type::SYS_CLASS::T) {
+      auto data = reinterpret_cast<Tag *>(
+          env.heap->HeapAddr(Fixnum::Int64Of(layout->offset)));
+
+      for (int64_t i = 0; i < Fixnum::Int64Of(layout->length); ++i)
+        fn(data[i]);
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/** * forward a tag during a minor collection **/
+Tag Heap::GcForward(Env &env, Tag ptr) {
+  Heap &heap = *env.heap;
+
+  switch (Type::TagOf(ptr)) {
+  case Type::TAG::CONS: {
+    Tag car = Cons::car(env, ptr);
+    Tag cdr = Cons::cdr(env, ptr);
+    Tag fcar = GcForward(env, car);
+    Tag fcdr = GcForward(env, cdr);
+
+    if (Type::Eq(car, fcar) && Type::Eq(cdr, fcdr))
+      return ptr;
+
+    std::optional<Tag> immediate = Cons::Immediate(fcar, fcdr);
+    if (immediate.has_value())
+      return immediate.value();
+
+    std::optional<int64_t> alloc =
+        heap.Tenure(sizeof(Cons::Layout), Type::SYS_CLASS::CONS);
+    if (!alloc.has_value())
+      throw std::runtime_error("heap exhausted");
+
+    Tag cons = Type::Entag(alloc.value(), Type::SYS_CLASS::CONS,
+                           Type::TAG::INDIRECT);
+    *Layout<Cons::Layout>(env, cons) = Cons::Layout{fcar, fcdr};
+
+    heap.scavenged.push_back(heap.Map(cons));
+    return cons;
+  }
+  case Type::TAG::INDIRECT: {
+    HeapInfo *hinfo = heap.Map(ptr);
+
+    if (!heap.IsNursery(hinfo) || RefBits(*hinfo) & GC_PIN)
+      return ptr;
+
+    if (!(RefBits(*hinfo) & GC_FORWARD)) {
+      std::optional<HeapInfo *> promoted = heap.Evacuate(hinfo);
+
+      /* no room to promote it, leave it where it is */
+      if (!promoted.has_value()) {
+        *hinfo = RefBits(*hinfo, RefBits(*hinfo) | GC_PIN);
+        heap.pinned.push_back(hinfo);
+        heap.scavenged.push_back(hinfo);
+
+        return ptr;
+      }
+
+      heap.scavenged.push_back(promoted.value());
+    }
+
+    auto forward = reinterpret_cast<HeapInfo *>(
+        heap.HeapAddr(-static_cast<int64_t>(Reloc(*hinfo))));
+
+    return Type::Entag(heap.HeapInfoTag(forward), Type::IndirectClass(ptr),
+                       Type::TAG::INDIRECT);
+  }
+  default:
+    return ptr;
+  }
+}
+
+/** * does this tag reference the nursery? **/
+bool Heap::IsYoung(Env &env, Tag ptr) {
+
+  switch (Type::TagOf(ptr)) {
+  case Type::TAG::CONS:
+    return IsYoung(env, Cons::car(env, ptr)) ||
+           IsYoung(env, Cons::cdr(env, ptr));
+  case Type::TAG::INDIRECT:
+    return env.heap->IsNursery(env.heap->Map(ptr));
+  default:
+    return false;
+  }
+}
+
+/** * does this tag reference outside the base? **/
+bool Heap::IsDynamic(Env &env, Tag ptr) {
+
+  switch (Type::TagOf(ptr)) {
+  case Type::TAG::CONS:
+    return IsDynamic(env, Cons::car(env, ptr)) ||
+           IsDynamic(env, Cons::cdr(env, ptr));
+  case Type::TAG::INDIRECT:
+    return !env.heap->IsBase(env.heap->Map(ptr));
+  default:
+    return false;
+  }
+}
+
+/** * was this tag allocated while the arena was open? **/
+bool Heap::InArena(Env &env, Arena &arena, Tag ptr) {
+
+  switch (Type::TagOf(ptr)) {
+  case Type::TAG::CONS:
+    return InArena(env, arena, Cons::car(env, ptr)) ||
+           InArena(env, arena, Cons::cdr(env, ptr));
+  case Type::TAG::INDIRECT: {
+    auto addr = reinterpret_cast<uint64_t>(env.heap->Map(ptr));
+
+    return (addr >= arena.top && addr < arena.limit) ||
+           (addr >= arena.barrier && addr < arena.barrier_limit);
+  }
+  default:
+    return false;
+  }
+}
+
+/** * the open arenas value was allocated in must keep it if ptr, a
+ ** holder or :nil for none, wasn't allocated there too **/
+void Heap::Escape(Env &env, Tag ptr, Tag value) {
+
+  if (alloc_buffer == nullptr)
+    return;
+
+  for (Arena *arena = alloc_buffer->arena; arena != nullptr;
+       arena = arena->outer)
+    if (!arena->escaped && InArena(env, *arena, value) &&
+        !InArena(env, *arena, ptr))
+      arena->escaped = true;
+}
+
+/** * remember old objects stored into with nursery references, and base
+ ** objects stored into with dynamic ones **/
+void Heap::WriteBarrier(Env &env, Tag ptr, Tag value) {
+
+  if (!Type::IsIndirect(ptr))
+    return;
+
+  if (alloc_buffer != nullptr && alloc_buffer->arena != nullptr)
+    Escape(env, ptr, value);
+
+  /* a page's objects are remembered by their page */
+  HeapInfo *hinfo = env.heap->HeaderOf(env.heap->Map(ptr));
+
+  if (env.heap->IsBase(hinfo) && !(RefBits(*hinfo) & GC_BASEREF) &&
+      IsDynamic(env, value)) {
+    *hinfo = RefBits(*hinfo, RefBits(*hinfo) | GC_BASEREF);
+    env.heap->base_remembered.push_back(hinfo);
+  }
+
+  if (RefBits(*hinfo) & GC_REMEMBER || env.heap->IsNursery(hinfo) ||
+      !IsYoung(env, value))
+    return;
+
+  *hinfo = RefBits(*hinfo, RefBits(*hinfo) | GC_REMEMBER);
+  env.heap->remembered.push_back(hinfo);
+}
+
+thread_local Heap::AllocBuffer *Heap::alloc_buffer = nullptr;
+
+std::optional<int64_t> Heap::GcAlloc(Env &env, int size,
+                                     Type::SYS_CLASS sys_class) {
+
   return env.heap->Alloc(size, sys_class);
 }
 
+/** * allocate a run of objects, adjacent when they fit **/
+bool Heap::GcAlloc(Env &env, int size, Type::SYS_CLASS sys_class,
+                   std::span<int64_t> run) {
+
+  return env.heap->Alloc(size, sys_class, run);
+}
+
 } /* namespace core */
 } /* namespace libmu */
@@ -13,11 +13,14 @@
 #if !defined(LIBMU_CORE_HEAP_H_)
 #define LIBMU_CORE_HEAP_H_
 
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <cinttypes>
 #include <functional>
 #include <map>
 #include <optional>
+#include <span>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
@@ -35,10 +38,77 @@ namespace core {
  **     heaps are no larger than 32 bits in size
  **     heap objects can be no larger than 16 bits in size
  **     heap objects are aligned on uint64_t boundaries
- **     think about reloc, map instead?
+ **     reloc is the forwarding offset of an evacuated object
  **     8 ref bits for gc
  **     type tag is 8 bits, currently we only use 4
  **
+ **     heaps are generational: new objects are allocated in a
+ **     nursery and survivors of a minor collection are promoted
+ **     by copying into the old generation. old objects that are
+ **     stored into get remembered by the write barrier.
+ **
+ **     each context bump allocates from its own buffer, a chunk
+ **     of the nursery handed out under the heap's lock. a buffer
+ **     keeps its own counts, they are merged into the heap's when
+ **     it is refilled and when the nursery is collected.
+ **
+ **     swept old generation space is kept on segregated size
+ **     class free lists, adjacent dead objects coalesce. the old
+ **     generation is swept lazily, a page at a time, when the
+ **     allocator runs out of free blocks.
+ **
+ **     a fragmented old generation is compacted instead, live
+ **     objects slide down over the dead ones and reloc holds
+ **     their destination until every reference is rewritten.
+ **
+ **     vector data bigger than LARGE_OBJECT is mapped on its own
+ **     pages outside the heap, the vector's offset points at it.
+ **     it is never moved, it is marked when its vector is and
+ **     the pages go back to the system when it dies.
+ **
+ **     free old generation pages past a retention mark are given
+ **     back to the system when a sweep or compaction finishes.
+ **
+ **     a mapped image's old generation is an immortal base. it
+ **     is never swept or moved and the collector only reads it,
+ **     so processes mapping the same image share its pages until
+ **     they store into them. the bootstrap objects are promoted
+ **     into the base, and the old generation can be on demand.
+ **     full collections don't trace the base, they scan only the
+ **     base objects remembered as referencing the rest of the heap.
+ **
+ **     collections are triggered by allocation. when the nursery
+ **     fills, or enough has been tenured since the last full
+ **     collection, the allocator asks for one and the evaluator
+ **     runs it at its next safe point, where every live object is
+ **     in a frame, a registered root or on the stack.
+ **
+ **     objects of the small fixed size classes (conses, symbols
+ **     and functions) are promoted into pages of their own, one
+ **     class to a page. the page has a header, its objects don't:
+ **     their class and size come from the page header, they have
+ **     object and mark bits like any other object, and the page
+ **     stands in for them in the remembered sets. pages never move,
+ **     a page with nothing live left in it is swept as free space.
+ **
+ **     ephemerons hold their value only while their key is
+ **     reachable through something else. a full collection marks
+ **     the values of those with marked keys until no more keys are
+ **     marked and breaks the rest. minor collections and the base
+ **     hold them strongly.
+ **
+ **     an arena is a scope whose allocations are thrown away when
+ **     it exits. it owns what its context carves out of the nursery
+ **     while it is open, and closing it hands that back by resetting
+ **     the bump pointers. it is kept instead when one of its objects
+ **     is stored outside it, returned or thrown, or when anything
+ **     else carves the nursery or collects while it is open. kept
+ **     objects are ordinary nursery objects.
+ **
+ **     a persistent heap is backed by a heap file. its pages are
+ **     mapped copy-on-write, a checkpoint writes the ones that
+ **     were stored into back to the file and maps them again.
+ **
  **/
 
 class Heap { /* heap pure abstract base class */
@@ -63,13 +133,22 @@ public:
    **/
   enum class HeapInfo : uint64_t {};
 
+  /** * largest object a HeapInfo can size **/
+  static const uint32_t MAX_OBJECT_WORDS = 0xffff;
+
+  /** * vector data larger than this lives in the large object space **/
+  static const size_t LARGE_OBJECT = 32768;
+
   /** * bytes to heap word offset **/
   static uint32_t HeapWords(uint32_t nbytes) {
     return (nbytes + sizeof(uint64_t) - 1) / sizeof(uint64_t);
   }
 
-  static HeapInfo MakeHeapInfo(uint16_t size, Type::SYS_CLASS tag) {
-    return HeapInfo((HeapWords(size) << 16) | std::to_underlying(tag));
+  static HeapInfo MakeHeapInfo(uint32_t size, Type::SYS_CLASS tag) {
+    assert(HeapWords(size) <= MAX_OBJECT_WORDS);
+
+    return HeapInfo((uint64_t{HeapWords(size)} << 16) |
+                    std::to_underlying(tag));
   }
 
   /** * SYS_CLASS from HeapInfo **/
@@ -108,29 +187,161 @@ public:
         (((reloc / 8) & 0xffffffff) << 32));
   }
 
+  /** * ref bits **/
+  static const uint8_t GC_REMEMBER = 0x2; /* in the remembered set */
+  static const uint8_t GC_FORWARD = 0x4;  /* evacuated, reloc forwards */
+  static const uint8_t GC_PIN = 0x8;      /* conservatively referenced */
+  static const uint8_t GC_BASEREF = 0x10; /* in the base remembered set */
+  static const uint8_t GC_PAGE = 0x20;    /* heads a page of objects */
+
+  /** * a page's header is followed by the size of its objects **/
+  static size_t PageObjectSize(HeapInfo *page) {
+    return reinterpret_cast<uint64_t *>(page)[1];
+  }
+
 public: /* gc */
-  std::unordered_map<Type::SYS_CLASS, std::vector<HeapInfo *>> free_lists;
+  std::vector<HeapInfo *> remembered; /* old objects referencing nursery */
+  std::vector<HeapInfo *> scavenged;  /* promoted objects yet to be scanned */
+  std::vector<HeapInfo *> pinned;     /* nursery objects kept in place */
+
+  /** * base objects referencing the dynamic heap **/
+  std::vector<HeapInfo *> base_remembered;
+
+  size_t gc_tenured; /* bytes tenured since the last full collection */
+
+  std::atomic<bool> gc_pending; /* the allocator wants a collection */
+
+  static const size_t MARK_STACK_MAX = 1 << 16;
 
-  static void Gc(Env &);
+  std::vector<HeapInfo *> ephemerons; /* marked ephemerons, keys unknown */
+  std::vector<HeapInfo *> mark_stack; /* marked objects yet to be scanned */
+  bool mark_overflow;                 /* mark stack overflowed, rescan */
+
+  static void Gc(Env &, bool);
+  static void GcFull(Env &, bool);
+  static void GcCompact(Env &);
+  static void GcMinor(Env &);
   static void GcMark(Env &, Type::Tag);
+  static void GcGray(Env &, Type::Tag);
+  static void GcScan(Env &, HeapInfo *);
   static bool IsGcMarked(Env &, Type::Tag);
+  static bool IsGcLive(Env &, Type::Tag);
+  static void GcEphemerons(Env &);
   static void GcSweep(Env &);
+  static void GcIdle(Env &);
+  static void GcSafePoint(Env &);
+  static size_t GcPromote(Env &);
+  static void GcBase(Env &);
+
+  static void GcStack(Env &, const std::function<void(HeapInfo *)> &);
+  static void GcSlots(Env &, HeapInfo *, const std::function<void(Type::Tag &)> &);
+  static Type::Tag GcForward(Env &, Type::Tag);
+  static Type::Tag GcRelocate(Env &, Type::Tag);
+  static bool IsYoung(Env &, Type::Tag);
+  static bool IsDynamic(Env &, Type::Tag);
+
+  static void WriteBarrier(Env &, Type::Tag, Type::Tag);
+
+  static std::optional<int64_t> GcAlloc(Env &, int, Type::SYS_CLASS);
+  static bool GcAlloc(Env &, int, Type::SYS_CLASS, std::span<int64_t>);
 
-  static std::optional<int> GcAlloc(Env &, int, Type::SYS_CLASS);
+public: /* arenas */
+  /** * a context's discardable scope, what was free when it opened **/
+  struct Arena {
+    Arena *outer;                   /* enclosing arena */
+    uint64_t top;                   /* buffer's next free byte */
+    uint64_t limit;                 /* end of the buffer's chunk */
+    uint64_t barrier;               /* nursery alloc barrier */
+    uint64_t barrier_limit;         /* end of the nursery gap */
+    size_t gap;                     /* the nursery gap */
+    uint64_t n_carved;              /* heap's carves */
+    uint64_t own_carved;            /* the buffer's carves */
+    size_t frames;                  /* owner's control stack depth */
+    size_t nbytes;                  /* bytes merged while open */
+    int n_objects;                  /* objects merged while open */
+    std::array<int, 16> type_alloc; /* type counts merged while open */
+    bool escaped;                   /* must be kept */
+  };
+
+  static bool InArena(Env &, Arena &, Type::Tag);
+  static void Escape(Env &, Type::Tag, Type::Tag);
+
+  virtual void OpenArena(Arena &) = 0;
+  virtual bool CloseArena(Arena &) = 0;
+
+public: /* allocation buffers */
+  /** * a context's private chunk of the nursery **/
+  struct AllocBuffer {
+    Heap *heap;                     /* owning heap */
+    uint64_t top;                   /* next free byte */
+    uint64_t limit;                 /* end of the chunk */
+    size_t nbytes;                  /* bytes allocated, not yet merged */
+    int n_objects;                  /* objects allocated, not yet merged */
+    std::array<int, 16> type_alloc; /* type counts, not yet merged */
+    Arena *arena;                   /* innermost open arena */
+    uint64_t n_carved;              /* trips to the shared nursery */
+  };
+
+  static thread_local AllocBuffer *alloc_buffer; /* this thread's buffer */
+
+  virtual void AttachBuffer(AllocBuffer &) = 0;
+  virtual void DetachBuffer(AllocBuffer &) = 0;
 
 public: /* derived types */
   virtual HeapInfo *Map(Type::Tag) = 0;
   virtual void Map(std::function<void(HeapInfo *)>) = 0;
 
+  virtual bool IsObject(HeapInfo *) = 0;
+  virtual bool IsHeapAddr(const void *) = 0;
+  virtual bool IsMarked(HeapInfo *) = 0;
+  virtual bool Mark(HeapInfo *) = 0;
+  virtual void ClearMarks() = 0;
+  virtual std::optional<HeapInfo *> MapInterior(uint64_t) = 0;
+  virtual bool IsNursery(HeapInfo *) = 0;
+  virtual bool IsBase(HeapInfo *) = 0;
+  virtual HeapInfo *HeaderOf(HeapInfo *) = 0;
+  virtual void MapPage(HeapInfo *, const std::function<void(HeapInfo *)> &) = 0;
+  virtual void MapBase(const std::function<void(HeapInfo *)> &) = 0;
+  virtual void MapDynamic(const std::function<void(HeapInfo *)> &) = 0;
+  virtual size_t Promote() = 0;
+  virtual size_t NurseryAlloc() = 0;
+  virtual size_t OldRoom() = 0;
+
+  virtual std::optional<int64_t> Tenure(int, Type::SYS_CLASS) = 0;
+  virtual std::optional<HeapInfo *> Evacuate(HeapInfo *) = 0;
+  virtual void Sweep() = 0;
+  virtual bool Sweep(size_t) = 0;
+  virtual bool IsFragmented() = 0;
+  virtual void Compact(const std::function<void()> &) = 0;
+  virtual void ResetNursery() = 0;
+  virtual void GcRoots(const std::function<void(Type::Tag &)> &) = 0;
+
   virtual void *HeapAddr(int64_t) = 0;
   virtual size_t HeapInfoTag(HeapInfo *) = 0;
   virtual std::optional<int64_t> Alloc(int, Type::SYS_CLASS) = 0;
-  virtual std::optional<Type::Tag> MapString(std::string &) = 0;
+  virtual bool Alloc(int, Type::SYS_CLASS, std::span<int64_t>) = 0;
+  virtual std::optional<void *> LargeAlloc(size_t) = 0;
+  virtual bool MarkLarge(uint64_t) = 0;
+  virtual void SweepLarge() = 0;
+  virtual size_t LargeSize() = 0;
+  virtual std::optional<Type::Tag> MapString(const char *, size_t) = 0;
 
   virtual Type::Tag InternString(Env &, Type::Tag) = 0;
+  virtual void
+  MapInterned(const std::function<std::optional<Type::Tag>(Type::Tag)> &) = 0;
+
+  virtual bool SaveImage(int, bool) = 0;
+  virtual bool MapImage(Env &, int, bool) = 0;
+  virtual bool MapPersistent(int, uint64_t, size_t, size_t) = 0;
+  virtual bool SyncPages(int, uint64_t, bool) = 0;
+  virtual size_t MaxPages() = 0;
 
   virtual uint32_t HeapSize() = 0;
   virtual uint32_t HeapAlloc() = 0;
+  virtual size_t HeapMapped() = 0;
+  virtual size_t HeapResident() = 0;
+  virtual void Retain(size_t) = 0;
+  virtual bool Grow(size_t) = 0;
 
   virtual int TypeAlloc(Type::SYS_CLASS) = 0;
   virtual int TypeAlloc() = 0;
@@ -138,7 +349,7 @@ public: /* derived types */
   virtual uint32_t Room(Type::SYS_CLASS) = 0;
   virtual uint32_t Room() = 0;
 
-  explicit Heap() = default;
+  explicit Heap() : gc_tenured(0), gc_pending(false), mark_overflow(false) {}
   virtual ~Heap() = default;
 
 }; /* class Heap */
@@ -0,0 +1,441 @@
+/********
+ **
+ **  SPDX-FileCopyrightText: Copyright 2017-2022 James M. Putnam
+ **  SPDX-License-Identifier: MIT
+ **
+ **/
+
+/********
+ **
+ **  image.cc: environment images
+ **
+ **/
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <optional>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "libmu/core/compile.h"
+#include "libmu/core/env.h"
+#include "libmu/core/heap.h"
+#include "libmu/core/nscache.h"
+#include "libmu/core/type.h"
+
+#include "libmu/type/namespace.h"
+#include "libmu/type/stream.h"
+#include "libmu/type/vector.h"
+
+#include "libmu/system/internals.h"
+#include "libmu/system/stream.h"
+
+namespace libmu {
+
+using Namespace = type::Namespace;
+using Stream = type::Stream;
+using Vector = type::Vector;
+
+namespace core {
+namespace {
+
+/**
+ * an image is an environment header, the namespaces, the compiler's
+ * lexicals and the stream records, followed by the heap's own section.
+ * heap tags are offsets from the heap base, so the heap maps anywhere.
+ **/
+static const char kImageMagic[8] = {'m', 'u', '-', 'i', 'm', 'a', 'g', 'e'};
+
+struct EnvImage {
+  char magic[8];
+  uint32_t format;
+  uint32_t page_size;
+  char mu_version[16];
+  int64_t frame_id;
+  uint64_t n_namespaces;
+  uint64_t n_lexicals;
+  uint64_t n_streams;
+  Tag version;
+  Tag env;
+  Tag mu;
+  Tag uninterned;
+  Tag system;
+  Tag standard_input;
+  Tag standard_output;
+  Tag error_output;
+};
+
+/** * a stream outlives its process only as a copy of its contents **/
+struct StreamImage {
+  Tag stream;
+  int32_t flags;
+  int32_t std_stream; /* STD_STREAM, or -1 */
+  uint64_t nbytes;    /* string contents follow */
+};
+
+auto std_stream_of(Env &env, system::Stream *stream) -> int32_t {
+
+  if (stream == env.sys.stdin)
+    return system::Stream::STDIN;
+  if (stream == env.sys.stdout)
+    return system::Stream::STDOUT;
+  if (stream == env.sys.stderr)
+    return system::Stream::STDERR;
+
+  return -1;
+}
+
+/** * reopen what can be reopened, the rest come back closed **/
+auto restore_stream(Env &env, const StreamImage &image,
+                    const std::string &contents) -> system::Stream * {
+
+  switch (image.std_stream) {
+  case system::Stream::STDIN:
+    return env.sys.stdin;
+  case system::Stream::STDOUT:
+    return env.sys.stdout;
+  case system::Stream::STDERR:
+    return env.sys.stderr;
+  default:
+    break;
+  }
+
+  if ((image.flags & system::Stream::STREAM_STRING) &&
+      !(image.flags & system::Stream::STREAM_CLOSED)) {
+    auto stream = (image.flags & system::Stream::STREAM_INPUT)
+                      ? system::Stream::OpenInputString(contents)
+                      : system::Stream::OpenOutputString(contents);
+
+    if (stream.has_value())
+      return stream.value();
+  }
+
+  return system::Stream::OpenClosed(image.flags);
+}
+
+/**
+ * a heap file is a header page, the heap's pages and a checkpoint, an
+ * image without the heap pages. the header page has two slots and the
+ * valid one with the later generation is current. a checkpoint marks
+ * the older slot WRITING before it changes the file, then overwrites
+ * the current slot with a CLEAN one. a torn slot fails its checksum,
+ * a file whose current slot is WRITING doesn't open.
+ **/
+static const char kHeapMagic[8] = {'m', 'u', '-', 'h', 'e', 'a', 'p', '\0'};
+static const size_t kSlotOffset[2] = {0, 512};
+
+enum SLOT_STATE : uint32_t { CLEAN = 1, WRITING = 2 };
+
+struct HeapSlot {
+  char magic[8];
+  uint32_t format;
+  uint32_t state;
+  uint64_t generation;
+  uint64_t ceiling;    /* heap pages reserved in the file */
+  uint64_t heap_pages; /* heap pages mapped from the file */
+  uint64_t checksum;   /* fnv-1a of the rest of the slot */
+};
+
+auto slot_checksum(const HeapSlot &slot) -> uint64_t {
+  auto bytes = reinterpret_cast<const unsigned char *>(&slot);
+  uint64_t hash = 0xcbf29ce484222325;
+
+  for (size_t i = 0; i < offsetof(HeapSlot, checksum); ++i)
+    hash = (hash ^ bytes[i]) * 0x100000001b3;
+
+  return hash;
+}
+
+/** * the checkpoint follows the heap file's heap pages **/
+auto checkpoint_offset(uint64_t ceiling) -> off_t {
+  return static_cast<off_t>((ceiling + 1) * system::System::PAGESIZE);
+}
+
+auto current_slot(int fd) -> std::optional<HeapSlot> {
+  std::optional<HeapSlot> current{};
+
+  for (auto offset : kSlotOffset) {
+    HeapSlot slot{};
+
+    if (lseek(fd, static_cast<off_t>(offset), SEEK_SET) < 0 ||
+        !system::System::ReadImage(fd, &slot, sizeof(slot)) ||
+        std::memcmp(slot.magic, kHeapMagic, sizeof(slot.magic)) != 0 ||
+        slot.format != Env::IMAGE_FORMAT ||
+        slot.checksum != slot_checksum(slot))
+      continue;
+
+    if (!current.has_value() || slot.generation > current->generation)
+      current = slot;
+  }
+
+  return current;
+}
+
+/** * generations alternate slots, the write is durable on return **/
+auto write_slot(int fd, HeapSlot slot) -> bool {
+
+  std::memcpy(slot.magic, kHeapMagic, sizeof(slot.magic));
+  slot.format = Env::IMAGE_FORMAT;
+  slot.checksum = slot_checksum(slot);
+
+  return lseek(fd, static_cast<off_t>(kSlotOffset[slot.generation % 2]),
+               SEEK_SET) >= 0 &&
+         system::System::WriteImage(fd, &slot, sizeof(slot)) &&
+         system::System::SyncFile(fd);
+}
+
+} /* anonymous namespace */
+
+/** * write the environment to an image file **/
+bool Env::SaveImage(const std::string &path) {
+
+  Heap::GcFull(*this, true);
+
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+    return false;
+
+  bool saved = SaveImage(fd, true);
+
+  return (close(fd) == 0) && saved;
+}
+
+/** * write an image at the file offset, the heap pages too if pages **/
+bool Env::SaveImage(int fd, bool pages) {
+  Env &env = *this;
+
+  std::vector<Tag> ns_tags{};
+  for (auto &[name, ns] : namespaces)
+    ns_tags.push_back(ns);
+
+  std::vector<StreamImage> streams{};
+  std::vector<std::string> contents{};
+
+  heap->Map([&env, &streams, &contents](Heap::HeapInfo *hinfo) {
+    if (Heap::SysClass(*hinfo) != SYS_CLASS::STREAM)
+      return;
+
+    Tag tag = Type::Entag(env.heap->HeapInfoTag(hinfo), SYS_CLASS::STREAM,
+                          Type::TAG::INDIRECT);
+    auto stream = Stream::stream(env, tag);
+    auto std_stream = std_stream_of(env, stream);
+
+    std::string str{};
+    if (std_stream < 0 && stream->IsString() && !stream->IsClosed())
+      str = stream->Contents();
+
+    streams.push_back({tag, stream->Flags(), std_stream, str.size()});
+    contents.push_back(str);
+  });
+
+  EnvImage image{};
+
+  std::memcpy(image.magic, kImageMagic, sizeof(image.magic));
+  std::strncpy(image.mu_version, VERSION, sizeof(image.mu_version) - 1);
+  image.format = IMAGE_FORMAT;
+  image.page_size = system::System::PAGESIZE;
+  image.frame_id = compiler->frame_id;
+  image.n_namespaces = ns_tags.size();
+  image.n_lexicals = compiler->lexicals.size();
+  image.n_streams = streams.size();
+  image.version = version;
+  image.env = env.env;
+  image.mu = mu;
+  image.uninterned = uninterned;
+  image.system = system;
+  image.standard_input = standard_input;
+  image.standard_output = standard_output;
+  image.error_output = error_output;
+
+  bool saved =
+      system::System::WriteImage(fd, &image, sizeof(image)) &&
+      system::System::WriteImage(fd, ns_tags.data(),
+                                 ns_tags.size() * sizeof(Tag)) &&
+      system::System::WriteImage(fd, compiler->lexicals.data(),
+                                 compiler->lexicals.size() * sizeof(Tag));
+
+  for (size_t i = 0; saved && i < streams.size(); ++i)
+    saved = system::System::WriteImage(fd, &streams[i], sizeof(StreamImage)) &&
+            system::System::WriteImage(fd, contents[i].data(),
+                                       contents[i].size());
+
+  return saved && heap->SaveImage(fd, pages);
+}
+
+/** * map an image file into a fresh environment **/
+bool Env::MapImage(const std::string &path) {
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  bool mapped = MapImage(fd, true);
+  close(fd);
+
+  return mapped;
+}
+
+/** * read an image at the file offset, mapping its heap pages if pages **/
+bool Env::MapImage(int fd, bool pages) {
+  Env &env = *this;
+
+  EnvImage image{};
+
+  if (!system::System::ReadImage(fd, &image, sizeof(image)) ||
+      std::memcmp(image.magic, kImageMagic, sizeof(image.magic)) != 0 ||
+      image.format != IMAGE_FORMAT ||
+      image.page_size != system::System::PAGESIZE ||
+      std::strncmp(image.mu_version, VERSION, sizeof(image.mu_version)) != 0)
+    return false;
+
+  std::vector<Tag> ns_tags(image.n_namespaces);
+  std::vector<StreamImage> streams(image.n_streams);
+  std::vector<std::string> contents(image.n_streams);
+
+  compiler->lexicals.resize(image.n_lexicals);
+
+  bool mapped =
+      system::System::ReadImage(fd, ns_tags.data(),
+                                ns_tags.size() * sizeof(Tag)) &&
+      system::System::ReadImage(fd, compiler->lexicals.data(),
+                                compiler->lexicals.size() * sizeof(Tag));
+
+  for (size_t i = 0; mapped && i < streams.size(); ++i) {
+    mapped = system::System::ReadImage(fd, &streams[i], sizeof(StreamImage));
+    if (mapped) {
+      contents[i].resize(streams[i].nbytes);
+      mapped = system::System::ReadImage(fd, contents[i].data(),
+                                         contents[i].size());
+    }
+  }
+
+  if (!mapped || !heap->MapImage(env, fd, pages))
+    return false;
+
+  compiler->frame_id = static_cast<int>(image.frame_id);
+
+  version = image.version;
+  env.env = image.env;
+  mu = image.mu;
+  uninterned = image.uninterned;
+  system = image.system;
+  standard_input = image.standard_input;
+  standard_output = image.standard_output;
+  error_output = image.error_output;
+
+  /* the namespace caches live outside the heap, rebuild them */
+  for (auto ns : ns_tags) {
+    namespaces[Vector::StdStringOf(env, Namespace::name(env, ns))] = ns;
+    Namespace::Cache(env, ns);
+  }
+
+  Namespace::Cache(env, uninterned);
+
+  for (size_t i = 0; i < streams.size(); ++i)
+    Stream::stream(env, streams[i].stream,
+                   restore_stream(env, streams[i], contents[i]));
+
+  Heap::GcBase(env);
+
+  return true;
+}
+
+/** * open a heap file, a new one is created from this environment **/
+bool Env::OpenHeap(const std::string &path) {
+  Env &env = *this;
+
+  if (heap_fd >= 0)
+    return false;
+
+  int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    return false;
+
+  auto current = current_slot(fd);
+
+  if (!current.has_value()) {
+    /* never overwrite a file that isn't ours */
+    if (lseek(fd, 0, SEEK_END) != 0 ||
+        !heap->MapPersistent(fd, system::System::PAGESIZE, heap->MaxPages(),
+                             0)) {
+      close(fd);
+      return false;
+    }
+
+    heap_fd = fd;
+    heap_generation = 0;
+    heap_ceiling = heap->MaxPages();
+
+    return Checkpoint();
+  }
+
+  if (current->state != CLEAN) {
+    close(fd);
+    return false;
+  }
+
+  /* the checkpoint replaces this environment */
+  namespaces.clear();
+  ns_cache = std::make_unique<NSCache>();
+  fn_cache = std::make_unique<FnCache>();
+
+  if (!heap->MapPersistent(fd, system::System::PAGESIZE, current->ceiling,
+                           current->heap_pages) ||
+      lseek(fd, checkpoint_offset(current->ceiling), SEEK_SET) < 0 ||
+      !env.MapImage(fd, false)) {
+    close(fd);
+    return false;
+  }
+
+  RebindFunctions();
+
+  heap_fd = fd;
+  heap_generation = current->generation;
+  heap_ceiling = current->ceiling;
+
+  return true;
+}
+
+/** * make the heap file's contents this environment **/
+bool Env::Checkpoint() {
+
+  if (heap_fd < 0)
+    return false;
+
+  Heap::GcFull(*this, true);
+
+  HeapSlot slot{};
+
+  slot.state = WRITING;
+  slot.generation = heap_generation + 1;
+  slot.ceiling = heap_ceiling;
+  slot.heap_pages = heap->HeapSize() / system::System::PAGESIZE;
+
+  /* a new heap file gets every page, mapped from an image or not */
+  if (!write_slot(heap_fd, slot) ||
+      !heap->SyncPages(heap_fd, system::System::PAGESIZE,
+                       heap_generation == 0) ||
+      lseek(heap_fd, checkpoint_offset(heap_ceiling), SEEK_SET) < 0 ||
+      !SaveImage(heap_fd, false))
+    return false;
+
+  off_t end = lseek(heap_fd, 0, SEEK_CUR);
+
+  if (end < 0 || !system::System::ResizeFile(heap_fd, end) ||
+      !system::System::SyncFile(heap_fd))
+    return false;
+
+  slot.state = CLEAN;
+  slot.generation = heap_generation + 2;
+
+  if (!write_slot(heap_fd, slot))
+    return false;
+
+  heap_generation = slot.generation;
+  return true;
+}
+
+} /* namespace core */
+} /* namespace libmu */
@@ -97,6 +97,26 @@ public:
     ns_cache_[ns]->externs.insert({hash, symbol});
   }
 
+  /** * visit cached namespaces and symbols **/
+  void GcRoots(const std::function<void(Tag &)> &fn) {
+    std::unordered_map<Tag, std::unique_ptr<NSMap>> cache{};
+
+    for (auto &[ns, nsmap] : ns_cache_) {
+      Tag key = ns;
+
+      for (auto &[hash, symbol] : nsmap->externs)
+        fn(symbol);
+
+      for (auto &[hash, symbol] : nsmap->interns)
+        fn(symbol);
+
+      fn(key);
+      cache[key] = std::move(nsmap);
+    }
+
+    ns_cache_.swap(cache);
+  }
+
 }; /* struct NSCache */
 
 } /* namespace core */
@@ -29,6 +29,7 @@
 #include "libmu/type/stream.h"
 #include "libmu/type/symbol.h"
 #include "libmu/type/vector.h"
+#include "libmu/type/weak.h"
 
 namespace libmu {
 
@@ -43,6 +44,7 @@ using Namespace = type::Namespace;
 using Stream = type::Stream;
 using Symbol = type::Symbol;
 using Vector = type::Vector;
+using Weak = type::Weak;
 
 namespace core {
 namespace {
@@ -60,7 +62,8 @@ static const std::map<Tag, SYS_CLASS> kSymbolMap{
     {Symbol::Keyword("stream"), SYS_CLASS::STREAM},
     {Symbol::Keyword("symbol"), SYS_CLASS::SYMBOL},
     {Symbol::Keyword("t"), SYS_CLASS::T},
-    {Symbol::Keyword("vector"), SYS_CLASS::VECTOR}};
+    {Symbol::Keyword("vector"), SYS_CLASS::VECTOR},
+    {Symbol::Keyword("weak"), SYS_CLASS::WEAK}};
 
 } /* anonymous namespace */
 
@@ -71,7 +74,8 @@ Tag Type::View(Env &env, Tag object) {
       {SYS_CLASS::FUNCTION, Function::View},
       {SYS_CLASS::NAMESPACE, Namespace::View},
       {SYS_CLASS::STREAM, Stream::View},
-      {SYS_CLASS::VECTOR, Vector::View}};
+      {SYS_CLASS::VECTOR, Vector::View},
+      {SYS_CLASS::WEAK, Weak::View}};
 
   return kViewMap.contains(Type::TypeOf(object))
              ? kViewMap.at(Type::TypeOf(object))(env, object)
@@ -108,7 +112,8 @@ Tag Type::MapClassSymbol(SYS_CLASS sys_class) {
       {SYS_CLASS::STREAM, Symbol::Keyword("stream")},
       {SYS_CLASS::SYMBOL, Symbol::Keyword("symbol")},
       {SYS_CLASS::T, Symbol::Keyword("t")},
-      {SYS_CLASS::VECTOR, Symbol::Keyword("vector")}};
+      {SYS_CLASS::VECTOR, Symbol::Keyword("vector")},
+      {SYS_CLASS::WEAK, Symbol::Keyword("weak")}};
 
   assert(kTypeMap.contains(sys_class));
 
@@ -112,7 +112,8 @@ public: /* Tag */
     NAMESPACE,
     STREAM,
     BYTE,
-    T
+    T,
+    WEAK
   };
 
   /** indirect pointers **/
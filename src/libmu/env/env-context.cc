@@ -67,10 +67,13 @@ void BindContext(Context &ctx, Frame &fp) {
   if (!Cons::IsList(vctx))
     Exception::Raise(ctx.env, "bind", "error", "type", vctx);
 
-  ctx.thread = std::make_unique<std::thread>([&ctx, &fn]() {
+  /* the thread conses in a context of its own */
+  ctx.thread = std::make_unique<std::thread>([&ctx, fn]() {
+    Context thread_ctx(ctx.env, Type::NIL);
+
     ctx.Suspend();
 
-    Env::Funcall(ctx, fn, std::vector<Tag>{});
+    Env::Funcall(thread_ctx, fn, std::vector<Tag>{});
   });
 
   // Context* nctx = new Context(ctx.env, thread->get_id(), vctx);
@@ -65,7 +65,7 @@ void EnvInfo(Context &ctx, Frame &fp) {
   fp.value = Cons::List(env, info);
 }
 
-/** * (hp-info type) => vector **/
+/** * (hp-info heap type) => vector **/
 void HeapInfo(Context &ctx, Frame &fp) {
   Tag heap = fp.argv[0];
   Tag type = fp.argv[1];
@@ -100,7 +100,9 @@ void HeapInfo(Context &ctx, Frame &fp) {
     fp.value =
         Vector(std::vector<Type::Tag>{Fixnum(ctx.env.heap->HeapSize()).tag_,
                                       Fixnum(ctx.env.heap->HeapAlloc()).tag_,
-                                      Fixnum(ctx.env.heap->TypeAlloc()).tag_})
+                                      Fixnum(ctx.env.heap->TypeAlloc()).tag_,
+                                      Fixnum(ctx.env.heap->HeapMapped()).tag_,
+                                      Fixnum(ctx.env.heap->HeapResident()).tag_})
             .Heap(ctx.env);
     break;
   default:
@@ -109,27 +111,72 @@ void HeapInfo(Context &ctx, Frame &fp) {
   }
 }
 
-/** * (gc) => boolean **/
+/** * (gc mode) => boolean **/
 void Gc(Context &ctx, Frame &fp) {
   Env &env = ctx.env;
+  Tag mode = fp.argv[0];
 
-  env.heap->Gc(env);
+  if (!Type::Null(mode) && !Type::Eq(mode, Symbol::Keyword("compact")))
+    Exception::Raise(env, "gc", "error", "type", mode);
 
-  for (auto [name, ns] : env.namespaces)
-    Env::Gc(env, ns);
+  core::Heap::Gc(env, !Type::Null(mode));
+  fp.value = Type::T;
+}
+
+/** * (arena fn) => object **/
+void WithArena(Context &ctx, Frame &fp) {
+  Env &env = ctx.env;
+  Tag thunk = fp.argv[0];
+
+  if (!Function::IsType(thunk))
+    Exception::Raise(env, "arena", "error", "type", thunk);
+
+  core::Heap::Arena arena{};
+
+  arena.frames = ctx.dynamic.size();
+  env.heap->OpenArena(arena);
+
+  try {
+    fp.value = Env::Funcall(ctx, thunk, std::vector<Tag>{});
+  } catch (...) {
+    arena.escaped = true;
+    env.heap->CloseArena(arena);
+    throw;
+  }
+
+  core::Heap::Escape(env, Type::NIL, fp.value);
+  env.heap->CloseArena(arena);
+}
+
+/** * (ckpt) => boolean **/
+void Checkpoint(Context &ctx, Frame &fp) {
+
+  if (ctx.env.heap_fd < 0) {
+    fp.value = Type::NIL;
+    return;
+  }
+
+  if (!ctx.env.Checkpoint())
+    Exception::Raise(ctx.env, "ckpt", "error", "value", Type::NIL);
 
-  env.heap->GcSweep(env);
   fp.value = Type::T;
 }
 
-/** * (saveimg form env => object **/
+/** * (static) => fixnum **/
+void Promote(Context &ctx, Frame &fp) {
+
+  fp.value = Fixnum(core::Heap::GcPromote(ctx.env)).tag_;
+}
+
+/** * (saveimg path) => boolean **/
 void SaveImage(Context &ctx, Frame &fp) {
   Tag fn = fp.argv[0];
 
   if (!Vector::IsTyped(ctx.env, fn, Type::SYS_CLASS::CHAR))
     Exception::Raise(ctx.env, "sv-img", "error", "type", fn);
 
-  system::System::SaveImage(ctx.env.sys, Vector::StdStringOf(ctx.env, fn));
+  if (!ctx.env.SaveImage(Vector::StdStringOf(ctx.env, fn)))
+    Exception::Raise(ctx.env, "sv-img", "error", "value", fn);
 
   fp.value = Type::T;
 }
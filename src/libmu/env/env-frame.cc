@@ -10,6 +10,7 @@
  **  env-frame.cc: library env
  **
  **/
+#include <algorithm>
 #include <cassert>
 
 #include "libmu/core/context.h"
@@ -41,6 +42,28 @@ using Tag = core::Type::Tag;
 using Type = core::Type;
 
 namespace env {
+namespace {
+
+/** * frames aren't barriered, a store into one older than an open arena
+ ** keeps the arena's objects past it **/
+void arena_escape(Context &ctx, Frame *frame, Tag value) {
+  size_t depth = 0; /* one past the frame on the control stack, if it is */
+
+  for (auto arena = ctx.alloc_buffer.arena; arena != nullptr;
+       arena = arena->outer) {
+    if (arena->escaped || !core::Heap::InArena(ctx.env, *arena, value))
+      continue;
+
+    if (depth == 0)
+      depth = ctx.dynamic.rend() -
+              std::find(ctx.dynamic.rbegin(), ctx.dynamic.rend(), frame);
+
+    if (depth <= arena->frames)
+      arena->escaped = true;
+  }
+}
+
+} /* anonymous namespace */
 
 /** * (lex-ref fixnum fixnum) => object **/
 void FrameRef(Context &ctx, Frame &fp) {
@@ -113,6 +136,7 @@ void FrameSet(Context &ctx, Frame &fp) {
 
   fp.value = frame.value()->argv[Fixnum::Int64Of(off)];
 
+  arena_escape(ctx, frame.value(), value);
   frame.value()->argv[Fixnum::Int64Of(off)] = value;
 }
 
@@ -0,0 +1,71 @@
+/********
+ **
+ **  SPDX-FileCopyrightText: Copyright 2017-2022 James M. Putnam
+ **  SPDX-License-Identifier: MIT
+ **
+ **/
+
+/********
+ **
+ **  env-weak.cc: library env
+ **
+ **/
+#include <cassert>
+
+#include "libmu/core/context.h"
+#include "libmu/core/env.h"
+#include "libmu/core/type.h"
+
+#include "libmu/type/exception.h"
+#include "libmu/type/weak.h"
+
+namespace libmu {
+
+using Exception = type::Exception;
+using Weak = type::Weak;
+
+using Context = core::Context;
+using Env = core::Env;
+using Frame = core::Context::Frame;
+using Tag = core::Type::Tag;
+using Type = core::Type;
+
+namespace env {
+
+/** * (weak key value) => weak **/
+void MakeWeak(Context &ctx, Frame &fp) {
+  fp.value = Weak(fp.argv[0], fp.argv[1]).Heap(ctx.env);
+}
+
+/** * (wk-key weak) => object **/
+void WeakKey(Context &ctx, Frame &fp) {
+  Tag weak = fp.argv[0];
+
+  if (!Weak::IsType(weak))
+    Exception::Raise(ctx.env, "wk-key", "error", "type", weak);
+
+  fp.value = Weak::key(ctx.env, weak);
+}
+
+/** * (wk-val weak) => object **/
+void WeakValue(Context &ctx, Frame &fp) {
+  Tag weak = fp.argv[0];
+
+  if (!Weak::IsType(weak))
+    Exception::Raise(ctx.env, "wk-val", "error", "type", weak);
+
+  fp.value = Weak::value(ctx.env, weak);
+}
+
+/** * (wk-live weak) => bool **/
+void WeakLive(Context &ctx, Frame &fp) {
+  Tag weak = fp.argv[0];
+
+  if (!Weak::IsType(weak))
+    Exception::Raise(ctx.env, "wk-live", "error", "type", weak);
+
+  fp.value = Weak::live(ctx.env, weak);
+}
+
+} /* namespace env */
+} /* namespace libmu */
@@ -24,6 +24,7 @@ using Frame = Context::Frame;
 namespace env {
 
 void BindContext(Context &, Frame &);
+void Checkpoint(Context &, Frame &);
 void ContextInfo(Context &, Frame &);
 void ContextFix(Context &, Frame &);
 void EnvInfo(Context &, Frame &);
@@ -37,10 +38,16 @@ void FrameSet(Context &, Frame &);
 void Gc(Context &, Frame &);
 void GetContext(Context &, Frame &);
 void HeapInfo(Context &, Frame &);
+void MakeWeak(Context &, Frame &);
 void Namespace(Context &, Frame &);
+void Promote(Context &, Frame &);
 void ResumeContext(Context &, Frame &);
 void SaveImage(Context &, Frame &);
 void SuspendContext(Context &, Frame &);
+void WeakKey(Context &, Frame &);
+void WeakLive(Context &, Frame &);
+void WeakValue(Context &, Frame &);
+void WithArena(Context &, Frame &);
 
 } /* namespace env */
 } /* namespace libmu */
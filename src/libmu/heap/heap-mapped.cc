@@ -12,7 +12,9 @@
  **/
 #include "libmu/heap/mapped.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <optional>
 
 #include <sys/mman.h>
@@ -39,123 +41,1610 @@ using Vector = type::Vector;
 namespace heap {
 
 namespace {
-Tag hash_id(std::string &str) {
-  static const int FNV_prime = 16777619;
-  static const uint64_t OFFSET_BASIS = 2166136261UL;
 
-  int64_t hash = OFFSET_BASIS;
+const Tag EMPTY = Tag(0);     /* never used slot, ends a probe */
+const Tag TOMBSTONE = Tag(1); /* removed slot, probes continue past it */
 
-  for (auto it = str.begin(); it != str.end(); ++it) {
-    hash ^= *it;
-    hash *= FNV_prime;
+/** * string hash, a word at a time **/
+uint64_t hash_string(const char *data, size_t nbytes) {
+  static const uint64_t MULTIPLIER = 0x9e3779b97f4a7c15;
+
+  uint64_t hash = nbytes * MULTIPLIER;
+  uint64_t word = 0;
+  size_t off = 0;
+
+  for (; off + sizeof(word) <= nbytes; off += sizeof(word)) {
+    std::memcpy(&word, data + off, sizeof(word));
+    hash = (std::rotl(hash, 5) ^ word) * MULTIPLIER;
+  }
+
+  if (off < nbytes) {
+    word = 0;
+    std::memcpy(&word, data + off, nbytes - off);
+    hash = (std::rotl(hash, 5) ^ word) * MULTIPLIER;
   }
 
-  return Fixnum(hash).tag_;
+  /* the table indexes on the low bits, fold the high ones down */
+  return hash ^ (hash >> 32);
 }
 
-Tag hash_id(Env &env, Tag str) {
-  static const int FNV_prime = 16777619;
-  static const uint64_t OFFSET_BASIS = 2166136261UL;
+} /* anonymous namespace */
+
+/** * a string's characters **/
+std::string_view Mapped::StringOf(Tag str) {
+  auto layout = reinterpret_cast<Vector::Layout *>(Map(str) + 1);
 
-  assert(Vector::IsTyped(env, str, Type::SYS_CLASS::CHAR));
+  return {reinterpret_cast<const char *>(
+              HeapAddr(Fixnum::Int64Of(layout->offset))),
+          static_cast<size_t>(Fixnum::Int64Of(layout->length))};
+}
 
-  int64_t hash = OFFSET_BASIS;
+/** * an intern table's slots and their number **/
+Mapped::Interned *Mapped::InternTable(Tag table, size_t *nslots) {
+  auto layout = reinterpret_cast<Vector::Layout *>(Map(table) + 1);
 
-  Vector::iter<char> iter(env, str);
-  for (auto it = iter.begin(); it != iter.end(); it = ++iter) {
-    hash ^= *it;
-    hash *= FNV_prime;
-  }
+  *nslots = Fixnum::Int64Of(layout->length) * sizeof(int64_t) /
+            sizeof(struct Interned);
 
-  return Fixnum(hash).tag_;
+  return reinterpret_cast<Interned *>(
+      HeapAddr(Fixnum::Int64Of(layout->offset)));
 }
 
-} /* anonymous namespace */
+/** * probe for a string, under the intern lock **/
+Mapped::Interned *Mapped::FindInterned(uint64_t hash, const char *data,
+                                       size_t nbytes) {
+  if (Type::Null(interned))
+    return nullptr;
+
+  size_t nslots;
+  Interned *table = InternTable(interned, &nslots);
+
+  for (size_t slot = hash & (nslots - 1);; slot = (slot + 1) & (nslots - 1)) {
+    Interned &entry = table[slot];
+
+    if (Type::Eq(entry.str, EMPTY))
+      return nullptr;
+
+    if (entry.hash == hash && !Type::Eq(entry.str, TOMBSTONE) &&
+        StringOf(entry.str) == std::string_view(data, nbytes))
+      return &entry;
+  }
+}
+
+/** * a fresh table sized for what's live, dropping the tombstones **/
+void Mapped::Rehash(Env &env) {
+  size_t nslots = INTERN_MIN;
+
+  while (nslots < (n_interned + 1) * 4)
+    nslots *= 2;
+
+  Tag table = Vector(std::vector<int64_t>(nslots * sizeof(struct Interned) /
+                                              sizeof(int64_t),
+                                          0))
+                  .Heap(env);
+
+  if (!Type::Null(interned)) {
+    size_t nold;
+    Interned *old = InternTable(interned, &nold);
+    Interned *fresh = InternTable(table, &nslots);
+
+    for (size_t i = 0; i < nold; ++i) {
+      if (Type::Eq(old[i].str, EMPTY) || Type::Eq(old[i].str, TOMBSTONE))
+        continue;
+
+      size_t slot = old[i].hash & (nslots - 1);
+      while (!Type::Eq(fresh[slot].str, EMPTY))
+        slot = (slot + 1) & (nslots - 1);
+
+      fresh[slot] = old[i];
+    }
+  }
+
+  interned = table;
+  n_tombstones = 0;
+}
 
 /** * string interning **/
-std::optional<Tag> Mapped::MapString(std::string &str) {
-  Tag id = hash_id(str);
+std::optional<Tag> Mapped::MapString(const char *data, size_t nbytes) {
+  std::lock_guard lock(intern_lock);
 
-  if (interned_strings.contains(id))
-    return interned_strings.at(id);
+  Interned *entry = FindInterned(hash_string(data, nbytes), data, nbytes);
+
+  if (entry == nullptr)
+    return std::nullopt;
 
-  return std::nullopt;
+  return entry->str;
 }
 
 Tag Mapped::InternString(Env &env, Tag str) {
-  Tag id = hash_id(env, str);
 
-  if (interned_strings.contains(id))
-    return interned_strings.at(id);
+  /* the table doesn't follow an arena, its strings aren't shared */
+  if (alloc_buffer != nullptr && alloc_buffer->arena != nullptr &&
+      InArena(env, *alloc_buffer->arena, str))
+    return str;
+
+  std::string_view chars = StringOf(str);
+  uint64_t hash = hash_string(chars.data(), chars.size());
+
+  std::lock_guard lock(intern_lock);
+
+  Interned *entry = FindInterned(hash, chars.data(), chars.size());
+  if (entry != nullptr)
+    return entry->str;
+
+  size_t nslots = 0;
+  if (!Type::Null(interned))
+    InternTable(interned, &nslots);
+
+  /* keep at least half the table never used so probes stay short */
+  if ((n_interned + n_tombstones + 1) * 2 > nslots)
+    Rehash(env);
+
+  Interned *table = InternTable(interned, &nslots);
+  size_t slot = hash & (nslots - 1);
+
+  while (!Type::Eq(table[slot].str, EMPTY) &&
+         !Type::Eq(table[slot].str, TOMBSTONE))
+    slot = (slot + 1) & (nslots - 1);
+
+  if (Type::Eq(table[slot].str, TOMBSTONE))
+    n_tombstones--;
+
+  table[slot] = Interned{hash, str};
+  n_interned++;
 
-  interned_strings[id] = str;
   return str;
 }
 
+/** * update or drop each interned string **/
+void Mapped::MapInterned(
+    const std::function<std::optional<Tag>(Tag)> &fn) {
+
+  if (Type::Null(interned))
+    return;
+
+  size_t nslots;
+  Interned *table = InternTable(interned, &nslots);
+
+  for (size_t slot = 0; slot < nslots; ++slot) {
+    Interned &entry = table[slot];
+
+    if (Type::Eq(entry.str, EMPTY) || Type::Eq(entry.str, TOMBSTONE))
+      continue;
+
+    std::optional<Tag> str = fn(entry.str);
+
+    if (!str.has_value()) {
+      entry.str = TOMBSTONE;
+      n_interned--;
+      n_tombstones++;
+    } else if (!Type::Eq(str.value(), entry.str))
+      entry.str = str.value();
+  }
+}
+
 size_t Mapped::HeapInfoTag(HeapInfo *hp) {
   return heap_addr - reinterpret_cast<size_t>(hp + size_t{1});
 }
 
 /** * allocate heap object **/
 std::optional<int64_t> Mapped::Alloc(int nbytes, SYS_CLASS tag) {
-  // NOLINTNEXTLINE(performance-no-int-to-ptr)
-  HeapInfo *halloc = reinterpret_cast<HeapInfo *>(alloc_barrier);
   size_t nalloc = sizeof(HeapInfo) + HeapWords(nbytes) * sizeof(uint64_t);
+  AllocBuffer *tlab = alloc_buffer;
 
-  if (alloc_barrier + nalloc > heap_addr + HeapSize())
-    return std::nullopt;
+  bool buffered =
+      tlab != nullptr && tlab->heap == this && nalloc <= BUFFER_BYTES / 4;
+
+  if (buffered && tlab->top + nalloc <= tlab->limit)
+    return BufferAlloc(*tlab, nalloc, tag);
+
+  std::lock_guard lock(alloc_lock);
+
+  n_carved++;
+  if (tlab != nullptr && tlab->heap == this)
+    tlab->n_carved++;
+
+  /* an empty buffer, an object too big to buffer or a full nursery */
+  if (buffered && Refill(*tlab, nalloc))
+    return BufferAlloc(*tlab, nalloc, tag);
+
+  return SharedAlloc(nalloc, tag);
+}
+
+/** * allocate a run of objects, one bump when the buffer can take them **/
+bool Mapped::Alloc(int nbytes, SYS_CLASS tag, std::span<int64_t> run) {
+  size_t nalloc = sizeof(HeapInfo) + HeapWords(nbytes) * sizeof(uint64_t);
+  size_t nrun = nalloc * run.size();
+  AllocBuffer *tlab = alloc_buffer;
+
+  bool buffered =
+      tlab != nullptr && tlab->heap == this && nrun <= BUFFER_BYTES / 4;
+
+  if (buffered && tlab->top + nrun <= tlab->limit) {
+    BufferAlloc(*tlab, nalloc, tag, run);
+    return true;
+  }
+
+  std::lock_guard lock(alloc_lock);
+
+  n_carved++;
+  if (tlab != nullptr && tlab->heap == this)
+    tlab->n_carved++;
+
+  if (buffered && Refill(*tlab, nrun)) {
+    BufferAlloc(*tlab, nalloc, tag, run);
+    return true;
+  }
+
+  /* a long run, or a full nursery, one at a time under the lock */
+  for (auto &offset : run) {
+    std::optional<int64_t> alloc = SharedAlloc(nalloc, tag);
+    if (!alloc.has_value())
+      return false;
+
+    offset = alloc.value();
+  }
+
+  return true;
+}
+
+/** * bump allocate in a context's buffer **/
+int64_t Mapped::BufferAlloc(AllocBuffer &tlab, size_t nalloc, SYS_CLASS tag) {
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  HeapInfo *halloc = reinterpret_cast<HeapInfo *>(tlab.top);
 
   *halloc = MakeHeapInfo(nalloc, tag);
+  SetObject(halloc, true);
+
+  tlab.top += nalloc;
+
+  /* metrics */
+  tlab.nbytes += nalloc;
+  tlab.n_objects++;
+  tlab.type_alloc[std::to_underlying(tag)]++;
+
+  return HeapInfoTag(halloc);
+}
+
+/** * bump allocate a run of objects in a context's buffer **/
+void Mapped::BufferAlloc(AllocBuffer &tlab, size_t nalloc, SYS_CLASS tag,
+                         std::span<int64_t> run) {
+
+  for (auto &offset : run) {
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    HeapInfo *halloc = reinterpret_cast<HeapInfo *>(tlab.top);
+
+    *halloc = MakeHeapInfo(nalloc, tag);
+    SetObject(halloc, true);
+
+    tlab.top += nalloc;
+    offset = HeapInfoTag(halloc);
+  }
+
+  /* metrics */
+  tlab.nbytes += nalloc * run.size();
+  tlab.n_objects += run.size();
+  tlab.type_alloc[std::to_underlying(tag)] += run.size();
+}
+
+/** * allocate under the lock from the nursery barrier **/
+std::optional<int64_t> Mapped::SharedAlloc(size_t nalloc, SYS_CLASS tag) {
+
+  while (alloc_barrier + nalloc > alloc_limit) {
+    if (gap + 1 >= nursery_gaps.size()) {
+      /* the nursery is full, allocate in the old generation */
+      std::optional<HeapInfo *> halloc = OldAlloc(nalloc, tag);
+
+      /* unbarriered old stores, open arenas can't be thrown away */
+      if (alloc_buffer != nullptr && alloc_buffer->heap == this)
+        KeepArenas(*alloc_buffer);
+
+      gc_pending = true;
+      if (!halloc.has_value())
+        return std::nullopt;
+
+      /* we haven't seen its contents, remember it */
+      HeapInfo *header = HeaderOf(halloc.value());
+      if (!(RefBits(*header) & GC_REMEMBER)) {
+        *header = RefBits(*header, RefBits(*header) | GC_REMEMBER);
+        remembered.push_back(header);
+      }
+
+      /* metrics */
+      n_objects++;
+      type_alloc->at(std::to_underlying(tag))++;
+
+      return HeapInfoTag(halloc.value());
+    }
+
+    gap++;
+    alloc_barrier = nursery_gaps[gap].first;
+    alloc_limit = nursery_gaps[gap].second;
+  }
+
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  HeapInfo *halloc = reinterpret_cast<HeapInfo *>(alloc_barrier);
+
+  *halloc = MakeHeapInfo(nalloc, tag);
+  SetObject(halloc, true);
 
   alloc_barrier += nalloc;
 
+  /* metrics, charged to the allocating context's buffer if it has one */
+  if (alloc_buffer != nullptr && alloc_buffer->heap == this) {
+    alloc_buffer->nbytes += nalloc;
+    alloc_buffer->n_objects++;
+    alloc_buffer->type_alloc[std::to_underlying(tag)]++;
+  } else {
+    nursery_alloc += nalloc;
+    n_objects++;
+    type_alloc->at(std::to_underlying(tag))++;
+  }
+
+  return HeapInfoTag(halloc);
+}
+
+/** * carve a fresh chunk out of the nursery for a buffer, under the lock **/
+bool Mapped::Refill(AllocBuffer &tlab, size_t nalloc) {
+
+  MergeBuffer(tlab);
+
+  /* a chunk owns its object bitmap words, nobody else sets their bits */
+  for (;;) {
+    uint64_t top = (alloc_barrier + BUFFER_ALIGN - 1) & ~(BUFFER_ALIGN - 1);
+    uint64_t limit =
+        std::min(top + BUFFER_BYTES, alloc_limit & ~(BUFFER_ALIGN - 1));
+
+    if (top + nalloc <= limit) {
+      tlab.top = top;
+      tlab.limit = limit;
+      alloc_barrier = limit;
+
+      return true;
+    }
+
+    if (gap + 1 >= nursery_gaps.size())
+      break;
+
+    gap++;
+    alloc_barrier = nursery_gaps[gap].first;
+    alloc_limit = nursery_gaps[gap].second;
+  }
+
+  tlab.top = tlab.limit = 0;
+  return false;
+}
+
+/** * fold a buffer's counts into the heap's, under the lock **/
+void Mapped::MergeBuffer(AllocBuffer &tlab) {
+
+  /* an open arena hands back what it merged if it's thrown away */
+  if (tlab.arena != nullptr) {
+    Arena &arena = *tlab.arena;
+
+    arena.nbytes += tlab.nbytes;
+    arena.n_objects += tlab.n_objects;
+    std::transform(arena.type_alloc.begin(), arena.type_alloc.end(),
+                   tlab.type_alloc.begin(), arena.type_alloc.begin(),
+                   std::plus<>());
+  }
+
+  nursery_alloc += tlab.nbytes;
+  n_objects += tlab.n_objects;
+  std::transform(type_alloc->begin(), type_alloc->end(),
+                 tlab.type_alloc.begin(), type_alloc->begin(), std::plus<>());
+
+  tlab.nbytes = 0;
+  tlab.n_objects = 0;
+  tlab.type_alloc.fill(0);
+}
+
+/** * the calling thread's counts, others merge when they refill **/
+void Mapped::MergeBuffer() {
+
+  if (alloc_buffer == nullptr || alloc_buffer->heap != this)
+    return;
+
+  std::lock_guard lock(alloc_lock);
+  MergeBuffer(*alloc_buffer);
+}
+
+/** * the nursery is about to be reset, empty every buffer **/
+void Mapped::RetireBuffers() {
+  std::lock_guard lock(alloc_lock);
+
+  for (auto tlab : buffers) {
+    MergeBuffer(*tlab);
+    KeepArenas(*tlab);
+    tlab->top = tlab->limit = 0;
+  }
+}
+
+void Mapped::AttachBuffer(AllocBuffer &tlab) {
+  std::lock_guard lock(alloc_lock);
+
+  /* a new context can be handed anything, keep the open arenas */
+  for (auto buffer : buffers)
+    KeepArenas(*buffer);
+
+  tlab = AllocBuffer{this, 0, 0, 0, 0, {}, nullptr, 0};
+  buffers.push_back(&tlab);
+}
+
+void Mapped::DetachBuffer(AllocBuffer &tlab) {
+  std::lock_guard lock(alloc_lock);
+
+  MergeBuffer(tlab);
+  std::erase(buffers, &tlab);
+}
+
+/** * map large vector data on its own pages **/
+/** * a buffer's open arenas can't be thrown away **/
+void Mapped::KeepArenas(AllocBuffer &tlab) {
+
+  for (Arena *arena = tlab.arena; arena != nullptr; arena = arena->outer)
+    arena->escaped = true;
+}
+
+/** * clear the object bits of the nursery words in [from, to) **/
+void Mapped::ClearObjects(uint64_t from, uint64_t to) {
+
+  for (size_t index = (from - heap_addr) / sizeof(uint64_t),
+              end = (to - heap_addr) / sizeof(uint64_t);
+       index < end;) {
+    size_t nbits = std::min(64 - index % 64, end - index);
+    uint64_t mask = nbits == 64 ? ~uint64_t{0}
+                                : ((uint64_t{1} << nbits) - 1) << (index % 64);
+
+    objmap[index / 64] &= ~mask;
+    index += nbits;
+  }
+}
+
+/** * open an arena on the calling context's buffer **/
+void Mapped::OpenArena(Arena &arena) {
+  AllocBuffer *tlab = alloc_buffer;
+
+  arena.escaped = tlab == nullptr || tlab->heap != this;
+  if (arena.escaped)
+    return;
+
+  std::lock_guard lock(alloc_lock);
+
+  /* counts merged from here on are the arena's */
+  MergeBuffer(*tlab);
+
+  arena.outer = tlab->arena;
+  arena.top = tlab->top;
+  arena.limit = tlab->limit;
+  arena.barrier = alloc_barrier;
+  arena.barrier_limit = alloc_limit;
+  arena.gap = gap;
+  arena.n_carved = n_carved;
+  arena.own_carved = tlab->n_carved;
+  arena.nbytes = 0;
+  arena.n_objects = 0;
+  arena.type_alloc.fill(0);
+
+  tlab->arena = &arena;
+}
+
+/** * close an arena, throw its allocations away if nothing kept them **/
+bool Mapped::CloseArena(Arena &arena) {
+  AllocBuffer *tlab = alloc_buffer;
+
+  if (tlab == nullptr || tlab->heap != this || tlab->arena != &arena)
+    return false;
+
+  std::lock_guard lock(alloc_lock);
+
+  tlab->arena = arena.outer;
+
+  /* only this buffer carved the nursery, and only in the arena's gap */
+  bool discard = !arena.escaped && gap == arena.gap &&
+                 n_carved - arena.n_carved == tlab->n_carved - arena.own_carved;
+
+  if (!discard) {
+    if (arena.outer != nullptr) {
+      Arena &outer = *arena.outer;
+
+      outer.nbytes += arena.nbytes;
+      outer.n_objects += arena.n_objects;
+      std::transform(outer.type_alloc.begin(), outer.type_alloc.end(),
+                     arena.type_alloc.begin(), outer.type_alloc.begin(),
+                     std::plus<>());
+    }
+
+    return false;
+  }
+
+  ClearObjects(arena.top, arena.limit);
+  ClearObjects(arena.barrier, alloc_barrier);
+
+  tlab->top = arena.top;
+  tlab->limit = arena.limit;
+  alloc_barrier = arena.barrier;
+
+  /* metrics */
+  nursery_alloc -= arena.nbytes;
+  n_objects -= arena.n_objects;
+  std::transform(type_alloc->begin(), type_alloc->end(),
+                 arena.type_alloc.begin(), type_alloc->begin(),
+                 std::minus<>());
+
+  tlab->nbytes = 0;
+  tlab->n_objects = 0;
+  tlab->type_alloc.fill(0);
+
+  return true;
+}
+
+std::optional<void *> Mapped::LargeAlloc(size_t nbytes) {
+  size_t npages = (nbytes + page_size - 1) / page_size;
+
+  std::optional<const char *> addr = system::System::AllocPages(npages);
+  if (!addr.has_value())
+    return std::nullopt;
+
+  /* allocate black, the vector isn't reachable yet */
+  large_objects[reinterpret_cast<uint64_t>(addr.value())] = {npages, true,
+                                                             false};
+  large_pages += npages;
+
+  /* counts toward the next full collection like a promotion */
+  gc_tenured += npages * page_size;
+  if (gc_tenured > OldRoom() / 2)
+    gc_pending = true;
+
+  return const_cast<char *>(addr.value());
+}
+
+/** * unmap large objects whose vectors died **/
+void Mapped::SweepLarge() {
+
+  std::erase_if(large_objects, [this](const auto &large) {
+    if (large.second.marked)
+      return false;
+
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    system::System::FreePages(reinterpret_cast<const char *>(large.first),
+                              large.second.npages);
+    large_pages -= large.second.npages;
+
+    return true;
+  });
+}
+
+/** * allocate heap object in the old generation **/
+std::optional<int64_t> Mapped::Tenure(int nbytes, SYS_CLASS tag) {
+  size_t nalloc = sizeof(HeapInfo) + HeapWords(nbytes) * sizeof(uint64_t);
+
+  std::optional<HeapInfo *> halloc = OldAlloc(nalloc, tag);
+  if (!halloc.has_value())
+    return std::nullopt;
+
   /* metrics */
   n_objects++;
   type_alloc->at(std::to_underlying(tag))++;
 
-  return heap_addr - reinterpret_cast<int64_t>(halloc + 1);
+  return HeapInfoTag(halloc.value());
+}
+
+std::optional<Heap::HeapInfo *> Mapped::OldAlloc(size_t nalloc,
+                                                 SYS_CLASS tag) {
+  struct ClassPages &paged = class_pages[std::to_underlying(tag)];
+
+  /* small fixed size objects go on their class's pages, headerless */
+  if (paged.nbytes != 0 && nalloc == sizeof(HeapInfo) + paged.nbytes) {
+    std::optional<HeapInfo *> halloc = PageAlloc(paged, tag);
+    if (!halloc.has_value())
+      return std::nullopt;
+
+    if (sweeping)
+      Mark(halloc.value());
+
+    gc_tenured += paged.nbytes;
+    if (gc_tenured > OldRoom() / 2)
+      gc_pending = true;
+
+    return halloc;
+  }
+
+  std::optional<struct FreeBlock> fit = FreeAlloc(nalloc);
+
+  /* sweep until something fits or there is nothing left to sweep */
+  while (!fit.has_value() && Sweep(1))
+    fit = FreeAlloc(nalloc);
+
+  HeapInfo *halloc = nullptr;
+
+  if (fit.has_value()) {
+    halloc = fit.value().hinfo;
+    free_bytes -= fit.value().nbytes;
+
+    /* split off the remainder */
+    AddFreeBlock(reinterpret_cast<uint64_t>(halloc) + nalloc,
+                 fit.value().nbytes - nalloc);
+  } else {
+    if (old_barrier + nalloc > heap_addr + HeapSize() &&
+        !Grow(old_barrier + nalloc - (heap_addr + HeapSize())))
+      return std::nullopt;
+
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    halloc = reinterpret_cast<HeapInfo *>(old_barrier);
+    old_barrier += nalloc;
+  }
+
+  *halloc = MakeHeapInfo(nalloc, tag);
+  SetObject(halloc, true);
+
+  /* allocate black, the sweep hasn't finished with this mark */
+  if (sweeping)
+    Mark(halloc);
+
+  gc_tenured += nalloc;
+  if (gc_tenured > OldRoom() / 2)
+    gc_pending = true;
+
+  return halloc;
+}
+
+/** * the next free object on a class's pages **/
+std::optional<Heap::HeapInfo *> Mapped::PageAlloc(struct ClassPages &paged,
+                                                  SYS_CLASS tag) {
+
+  for (;;) {
+    if (!paged.pages.empty()) {
+      HeapInfo *page = paged.pages.back();
+      uint64_t first = reinterpret_cast<uint64_t>(page) + PAGE_OBJECTS -
+                       sizeof(HeapInfo);
+
+      for (; paged.next < PageCapacity(page); ++paged.next) {
+        // NOLINTNEXTLINE(performance-no-int-to-ptr)
+        auto hinfo =
+            reinterpret_cast<HeapInfo *>(first + paged.next * paged.nbytes);
+
+        if (!IsObject(hinfo)) {
+          SetObject(hinfo, true);
+          paged.next++;
+
+          return hinfo;
+        }
+      }
+
+      paged.pages.pop_back();
+      paged.next = 0;
+      continue;
+    }
+
+    /* sweeping may turn up pages with room, if not start a new one */
+    if (Sweep(1) || !paged.pages.empty())
+      continue;
+
+    std::optional<HeapInfo *> page = NewPage(tag, paged.nbytes);
+    if (!page.has_value())
+      return std::nullopt;
+
+    paged.pages.push_back(page.value());
+  }
+}
+
+/** * start a page for a class's objects, on a page boundary **/
+std::optional<Heap::HeapInfo *> Mapped::NewPage(SYS_CLASS tag, size_t nbytes) {
+  uint64_t page_mask = page_size - 1;
+  uint64_t page;
+
+  /* any free block two pages long has an aligned page in it */
+  std::optional<struct FreeBlock> fit = FreeAlloc(2 * page_size);
+
+  if (fit.has_value()) {
+    auto start = reinterpret_cast<uint64_t>(fit.value().hinfo);
+    uint64_t end = start + fit.value().nbytes;
+
+    page = (start + page_mask) & ~page_mask;
+    free_bytes -= fit.value().nbytes;
+
+    AddFreeBlock(start, page - start);
+    AddFreeBlock(page + page_size, end - (page + page_size));
+  } else {
+    page = (old_barrier + page_mask) & ~page_mask;
+
+    if (page + page_size > heap_addr + HeapSize() &&
+        !Grow(page + page_size - (heap_addr + HeapSize())))
+      return std::nullopt;
+
+    /* a sweep in progress frees the gap when it gets there */
+    if (!sweeping)
+      AddFreeBlock(old_barrier, page - old_barrier);
+
+    old_barrier = page + page_size;
+  }
+
+  size_t word = (page - heap_addr) / sizeof(uint64_t) / 64;
+  std::fill(objmap.begin() + word,
+            objmap.begin() + word + page_size / sizeof(uint64_t) / 64, 0);
+
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  auto hinfo = reinterpret_cast<HeapInfo *>(page);
+
+  *hinfo = RefBits(MakeHeapInfo(page_size, tag), GC_PAGE);
+  reinterpret_cast<uint64_t *>(hinfo)[1] = nbytes;
+  SetObject(hinfo, true);
+
+  if (sweeping)
+    Mark(hinfo);
+
+  return hinfo;
+}
+
+/** * a live page with free objects goes back on its class's list **/
+void Mapped::ReusePage(HeapInfo *page) {
+  size_t nobjects = 0;
+
+  MapPage(page, [&nobjects](HeapInfo *) { nobjects++; });
+
+  if (nobjects < PageCapacity(page))
+    class_pages[std::to_underlying(SysClass(*page))].pages.push_back(page);
+}
+
+/** * forget the pages with room, a sweep or compaction finds them **/
+void Mapped::ClearPages() {
+
+  for (auto &paged : class_pages) {
+    paged.pages.clear();
+    paged.next = 0;
+  }
+}
+
+/** * take a block off the free lists **/
+std::optional<struct Mapped::FreeBlock> Mapped::FreeAlloc(size_t nalloc) {
+  std::optional<struct FreeBlock> fit = std::nullopt;
+  size_t size_class = SizeClass(nalloc);
+
+  /* exact classes fit anything on them, range classes need a look */
+  if (size_class <= N_EXACT) {
+    if (!free_blocks[size_class].empty()) {
+      fit = free_blocks[size_class].back();
+      free_blocks[size_class].pop_back();
+    }
+  } else {
+    auto &blocks = free_blocks[size_class];
+    auto block =
+        std::find_if(blocks.begin(), blocks.end(),
+                     [nalloc](struct FreeBlock &fb) { return fb.nbytes >= nalloc; });
+
+    if (block != blocks.end()) {
+      fit = *block;
+      *block = blocks.back();
+      blocks.pop_back();
+    }
+  }
+
+  /* anything in a larger class will do */
+  for (size_t nth = size_class + 1; !fit.has_value() && nth < N_CLASSES;
+       ++nth)
+    if (!free_blocks[nth].empty()) {
+      fit = free_blocks[nth].back();
+      free_blocks[nth].pop_back();
+    }
+
+  return fit;
+}
+
+/** * put a free block on its size class list **/
+void Mapped::AddFreeBlock(uint64_t addr, size_t nbytes) {
+
+  /* too small to hold an object, the next sweep reclaims it */
+  if (nbytes < 2 * sizeof(uint64_t))
+    return;
+
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  free_blocks[SizeClass(nbytes)].push_back(
+      {reinterpret_cast<HeapInfo *>(addr), nbytes});
+  free_bytes += nbytes;
+}
+
+/** * vector data is inline, rebase it after a move **/
+void Mapped::Rebase(HeapInfo *from, HeapInfo *to) {
+
+  if (SysClass(*to) != SYS_CLASS::VECTOR)
+    return;
+
+  auto layout = reinterpret_cast<Vector::Layout *>(to + 1);
+  auto data =
+      reinterpret_cast<uint64_t>(HeapAddr(Fixnum::Int64Of(layout->offset)));
+  auto base = reinterpret_cast<uint64_t>(from + 1);
+
+  if (data >= base && data <= reinterpret_cast<uint64_t>(from) + Size(*to))
+    layout->offset =
+        Fixnum(heap_addr - (reinterpret_cast<uint64_t>(to + 1) + (data - base)))
+            .tag_;
+}
+
+/** * promote a nursery object, leave a forwarding reloc behind **/
+std::optional<Heap::HeapInfo *> Mapped::Evacuate(HeapInfo *hinfo) {
+  size_t nbytes = Size(*hinfo);
+
+  std::optional<HeapInfo *> promoted = OldAlloc(nbytes, SysClass(*hinfo));
+  if (!promoted.has_value())
+    return std::nullopt;
+
+  HeapInfo *to = promoted.value();
+  std::memcpy(to + 1, hinfo + 1, nbytes - sizeof(HeapInfo));
+
+  /* paged objects have no header to look at, and are never vectors */
+  if (HeaderOf(to) == to)
+    Rebase(hinfo, to);
+
+  *hinfo = Reloc(RefBits(*hinfo, RefBits(*hinfo) | GC_FORWARD),
+                 reinterpret_cast<uint64_t>(to) - heap_addr);
+
+  return to;
+}
+
+/** * start rebuilding the free lists from the mark bitmap **/
+void Mapped::Sweep() {
+
+  for (auto &blocks : free_blocks)
+    blocks.clear();
+
+  free_bytes = 0;
+  ClearPages();
+
+  size_t nursery_words = (nursery_end - heap_addr) / sizeof(uint64_t) / 64;
+
+  /* nursery survivors stay put */
+  for (size_t word = 0; word < nursery_words; ++word)
+    objmap[word] &= markmap[word];
+
+  PinNursery();
+
+  /* the old generation is swept on demand, the base never is */
+  sweeping = true;
+  sweep_word = (base_end - heap_addr) / sizeof(uint64_t) / 64;
+  sweep_limit = (old_barrier - heap_addr + 64 * sizeof(uint64_t) - 1) /
+                sizeof(uint64_t) / 64;
+  sweep_free = base_end;
+}
+
+/** * sweep some pages of the old generation, true if more remain **/
+bool Mapped::Sweep(size_t npages) {
+
+  if (!sweeping)
+    return false;
+
+  size_t page_words = page_size / sizeof(uint64_t) / 64;
+  size_t limit = sweep_limit;
+
+  if (npages < (sweep_limit - sweep_word) / page_words)
+    limit = sweep_word + npages * page_words;
+
+  /* runs of dead objects between live ones coalesce */
+  for (; sweep_word < limit; ++sweep_word) {
+    objmap[sweep_word] &= markmap[sweep_word];
+
+    /* a live page stays put, its dead objects are freed in place */
+    if (IsPageWord(sweep_word)) {
+      uint64_t page = heap_addr + sweep_word * 64 * sizeof(uint64_t);
+
+      for (size_t word = 1; word < page_words; ++word)
+        objmap[sweep_word + word] &= markmap[sweep_word + word];
+
+      if (page > sweep_free)
+        AddFreeBlock(sweep_free, page - sweep_free);
+
+      sweep_free = page + page_size;
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      ReusePage(reinterpret_cast<HeapInfo *>(page));
+
+      sweep_word += page_words - 1;
+      continue;
+    }
+
+    for (uint64_t live = objmap[sweep_word]; live != 0; live &= live - 1) {
+      uint64_t addr = heap_addr + (sweep_word * 64 + std::countr_zero(live)) *
+                                      sizeof(uint64_t);
+
+      if (addr > sweep_free)
+        AddFreeBlock(sweep_free, addr - sweep_free);
+
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      sweep_free = addr + Size(*reinterpret_cast<HeapInfo *>(addr));
+    }
+  }
+
+  if (sweep_word < sweep_limit)
+    return true;
+
+  /* a dead run at the top goes back to the barrier */
+  uint64_t end = heap_addr + sweep_limit * 64 * sizeof(uint64_t);
+
+  if (old_barrier <= end)
+    old_barrier = sweep_free;
+  else if (sweep_free < end)
+    AddFreeBlock(sweep_free, end - sweep_free);
+
+  sweeping = false;
+  Release();
+
+  return false;
+}
+
+/** * slide live old objects down, pinned ones and the base stay put **/
+void Mapped::Compact(const std::function<void()> &relocate) {
+  size_t nursery_words = (nursery_end - heap_addr) / sizeof(uint64_t) / 64;
+  size_t base_words = (base_end - heap_addr) / sizeof(uint64_t) / 64;
+  size_t limit = (old_barrier - heap_addr + 64 * sizeof(uint64_t) - 1) /
+                 sizeof(uint64_t) / 64;
+  size_t page_words = page_size / sizeof(uint64_t) / 64;
+
+  for (auto &blocks : free_blocks)
+    blocks.clear();
+
+  free_bytes = 0;
+  sweeping = false;
+  ClearPages();
+
+  /* drop the dead, keep nursery survivors where they are */
+  for (size_t word = 0; word < limit; ++word)
+    if (word < nursery_words || word >= base_words)
+      objmap[word] &= markmap[word];
+
+  PinNursery();
+
+  /* plan: reloc is where each object goes, gaps before pins and pages
+     are free */
+  uint64_t free = base_end;
+
+  for (size_t word = base_words; word < limit; ++word) {
+    if (IsPageWord(word)) {
+      uint64_t page = heap_addr + word * 64 * sizeof(uint64_t);
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      auto hinfo = reinterpret_cast<HeapInfo *>(page);
+
+      AddFreeBlock(free, page - free);
+      *hinfo = Reloc(*hinfo, page - heap_addr);
+      free = page + page_size;
+      ReusePage(hinfo);
+
+      word += page_words - 1;
+      continue;
+    }
+
+    for (uint64_t live = objmap[word]; live != 0; live &= live - 1) {
+      uint64_t addr =
+          heap_addr + (word * 64 + std::countr_zero(live)) * sizeof(uint64_t);
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      auto hinfo = reinterpret_cast<HeapInfo *>(addr);
+
+      if (RefBits(*hinfo) & GC_PIN) {
+        AddFreeBlock(free, addr - free);
+        free = addr;
+      }
+
+      *hinfo = Reloc(*hinfo, free - heap_addr);
+      free += Size(*hinfo);
+    }
+  }
+
+  relocate();
+
+  /* move, objects only go down so the bitmap is rebuilt behind us */
+  for (size_t word = base_words; word < limit; ++word) {
+    if (IsPageWord(word)) {
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      auto hinfo = reinterpret_cast<HeapInfo *>(heap_addr +
+                                                word * 64 * sizeof(uint64_t));
+
+      *hinfo = Reloc(*hinfo, 0);
+      word += page_words - 1;
+      continue;
+    }
+
+    uint64_t live = objmap[word];
+
+    objmap[word] = 0;
+    for (; live != 0; live &= live - 1) {
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      auto hinfo = reinterpret_cast<HeapInfo *>(
+          heap_addr + (word * 64 + std::countr_zero(live)) * sizeof(uint64_t));
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      auto to = reinterpret_cast<HeapInfo *>(heap_addr + Reloc(*hinfo));
+
+      if (to != hinfo)
+        std::memmove(to, hinfo, Size(*hinfo));
+
+      *to = Reloc(RefBits(*to, RefBits(*to) & ~GC_PIN), 0);
+      Rebase(hinfo, to);
+      SetObject(to, true);
+    }
+  }
+
+  old_barrier = free;
+  Release();
+}
+
+/** * give free pages past the retention back to the system **/
+void Mapped::Release() {
+  size_t retained = 0;
+
+  /* the lowest pages of each run are kept until the retention is met */
+  auto release = [this, &retained](uint64_t start, uint64_t end) {
+    uint64_t first = (start + page_size - 1) / page_size * page_size;
+    uint64_t last = end / page_size * page_size;
+
+    if (first >= last)
+      return;
+
+    size_t npages = (last - first) / page_size;
+    size_t keep =
+        std::min(npages, (retain - std::min(retain, retained)) / page_size);
+
+    retained += keep * page_size;
+    if (keep < npages)
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      system::System::ReleasePages(
+          reinterpret_cast<const char *>(first + keep * page_size),
+          npages - keep);
+  };
+
+  /* the barrier allocates out of the top first */
+  release(old_barrier, heap_addr + HeapSize());
+
+  for (auto &blocks : free_blocks)
+    for (auto &block : blocks)
+      release(reinterpret_cast<uint64_t>(block.hinfo),
+              reinterpret_cast<uint64_t>(block.hinfo) + block.nbytes);
+}
+
+/** * resident heap and large object pages **/
+size_t Mapped::HeapResident() {
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  size_t npages = system::System::ResidentPages(
+      reinterpret_cast<const char *>(heap_addr), n_pages);
+
+  for (auto &[addr, large] : large_objects)
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    npages += system::System::ResidentPages(
+        reinterpret_cast<const char *>(addr), large.npages);
+
+  return npages * page_size;
+}
+
+/** * nursery objects left in the object bitmap stay put **/
+void Mapped::PinNursery() {
+  size_t nursery_words = (nursery_end - heap_addr) / sizeof(uint64_t) / 64;
+
+  for (size_t word = 0; word < nursery_words; ++word)
+    for (uint64_t live = objmap[word]; live != 0; live &= live - 1)
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      pinned.push_back(reinterpret_cast<HeapInfo *>(
+          heap_addr + (word * 64 + std::countr_zero(live)) * sizeof(uint64_t)));
+}
+
+/** * empty the nursery of everything but pinned objects **/
+void Mapped::ResetNursery() {
+
+  RetireBuffers();
+
+  std::sort(pinned.begin(), pinned.end());
+
+  std::fill(objmap.begin(),
+            objmap.begin() + (nursery_end - heap_addr) / sizeof(uint64_t) / 64,
+            0);
+
+  nursery_gaps.clear();
+  nursery_alloc = 0;
+
+  uint64_t base = heap_addr;
+  for (auto hinfo : pinned) {
+    auto addr = reinterpret_cast<uint64_t>(hinfo);
+
+    *hinfo = RefBits(*hinfo, RefBits(*hinfo) & ~GC_PIN);
+    SetObject(hinfo, true);
+
+    if (addr > base)
+      nursery_gaps.push_back({base, addr});
+
+    base = addr + Size(*hinfo);
+    nursery_alloc += Size(*hinfo);
+  }
+
+  if (base < nursery_end)
+    nursery_gaps.push_back({base, nursery_end});
+
+  pinned.clear();
+
+  gap = 0;
+  alloc_barrier = nursery_gaps.empty() ? nursery_end : nursery_gaps[0].first;
+  alloc_limit = nursery_gaps.empty() ? nursery_end : nursery_gaps[0].second;
+}
+
+/** * first object at or after addr **/
+Heap::HeapInfo *Mapped::NextObject(uint64_t addr) {
+
+  if (addr >= old_barrier)
+    return nullptr;
+
+  size_t index = (addr - heap_addr) / sizeof(uint64_t);
+  size_t limit = (old_barrier - heap_addr) / sizeof(uint64_t);
+  size_t word = index / 64;
+  uint64_t bits = objmap[word] & (~uint64_t{0} << (index % 64));
+
+  while (bits == 0) {
+    if (++word * 64 >= limit)
+      return nullptr;
+
+    bits = objmap[word];
+  }
+
+  index = word * 64 + __builtin_ctzll(bits);
+  if (index >= limit)
+    return nullptr;
+
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  return reinterpret_cast<HeapInfo *>(heap_addr + index * sizeof(uint64_t));
+}
+
+/** * object containing addr, if any **/
+std::optional<Heap::HeapInfo *> Mapped::MapInterior(uint64_t addr) {
+  /* objects are at most 16 bits of words long */
+  static const size_t MAX_OBJMAP_WORDS = 0x10000 / 64 + 1;
+
+  if (addr < heap_addr || addr >= old_barrier)
+    return std::nullopt;
+
+  /* objects on a page are found by their size */
+  std::optional<HeapInfo *> page = PageOf(addr);
+  if (page.has_value()) {
+    uint64_t first = reinterpret_cast<uint64_t>(page.value()) + PAGE_OBJECTS;
+    size_t nbytes = PageObjectSize(page.value());
+
+    if (addr < first || (addr - first) / nbytes >= PageCapacity(page.value()))
+      return std::nullopt;
+
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    auto hinfo = reinterpret_cast<HeapInfo *>(
+        first - sizeof(HeapInfo) + (addr - first) / nbytes * nbytes);
+
+    return IsObject(hinfo) ? std::optional<HeapInfo *>{hinfo} : std::nullopt;
+  }
+
+  size_t index = (addr - heap_addr) / sizeof(uint64_t);
+  size_t word = index / 64;
+  uint64_t bits =
+      objmap[word] & (~uint64_t{0} >> (63 - index % 64));
+
+  for (size_t n = 0; bits == 0 && word > 0 && n < MAX_OBJMAP_WORDS; ++n)
+    bits = objmap[--word];
+
+  if (bits == 0)
+    return std::nullopt;
+
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  auto hinfo = reinterpret_cast<HeapInfo *>(
+      heap_addr + (word * 64 + 63 - __builtin_clzll(bits)) * sizeof(uint64_t));
+
+  if (addr >= reinterpret_cast<uint64_t>(hinfo) + Size(*hinfo))
+    return std::nullopt;
+
+  return hinfo;
+}
+
+/** * write the heap section of an image, with the heap pages if pages **/
+bool Mapped::SaveImage(int fd, bool pages) {
+  std::vector<struct LargeImage> large{};
+  std::vector<const char *> large_addrs{};
+
+  /* finish any lazy sweep, the objmap is saved as is */
+  while (Sweep(n_pages))
+    ;
+
+  /* large data is saved with the vector that owns it */
+  Map([this, &large, &large_addrs](HeapInfo *hinfo) {
+    if (SysClass(*hinfo) != SYS_CLASS::VECTOR)
+      return;
+
+    auto layout = reinterpret_cast<Vector::Layout *>(hinfo + 1);
+    auto data =
+        reinterpret_cast<uint64_t>(HeapAddr(Fixnum::Int64Of(layout->offset)));
+    auto found = FindLarge(data);
+
+    if (found.has_value()) {
+      large.push_back({Type::Entag(HeapInfoTag(hinfo), SYS_CLASS::VECTOR,
+                                   Type::TAG::INDIRECT),
+                       found.value()->second.npages});
+      // NOLINTNEXTLINE(performance-no-int-to-ptr)
+      large_addrs.push_back(reinterpret_cast<const char *>(data));
+    }
+  });
+
+  /* the remember bit is saved in the header, the set must be too */
+  std::vector<uint64_t> remember{};
+  for (auto hinfo : remembered)
+    remember.push_back(reinterpret_cast<uint64_t>(hinfo) - heap_addr);
+
+  struct HeapImage image {};
+
+  image.heap_bytes = old_barrier - heap_addr;
+  image.nursery_bytes = nursery_end - heap_addr;
+  image.base_bytes = base_end - heap_addr;
+  image.n_pages = n_pages;
+  image.interned = interned;
+  image.n_large = large.size();
+  image.n_remembered = remember.size();
+  image.n_objects = n_objects;
+  std::copy(type_alloc->begin(), type_alloc->end(), image.type_alloc);
+
+  size_t objmap_words = (image.heap_bytes / sizeof(uint64_t) + 63) / 64;
+
+  if (!system::System::WriteImage(fd, &image, sizeof(image)) ||
+      !system::System::WriteImage(fd, objmap.data(),
+                                  objmap_words * sizeof(uint64_t)) ||
+      !system::System::WriteImage(fd, large.data(),
+                                  large.size() * sizeof(struct LargeImage)) ||
+      !system::System::WriteImage(fd, remember.data(),
+                                  remember.size() * sizeof(uint64_t)))
+    return false;
+
+  /* pages are aligned in the file so they can be mapped back */
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+  if (offset < 0 || lseek(fd, (offset + page_size - 1) / page_size * page_size,
+                          SEEK_SET) < 0)
+    return false;
+
+  size_t heap_pages = (image.heap_bytes + page_size - 1) / page_size;
+
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  if (pages && !system::System::WriteImage(
+                   fd, reinterpret_cast<void *>(heap_addr),
+                   heap_pages * page_size))
+    return false;
+
+  for (size_t i = 0; i < large.size(); ++i)
+    if (!system::System::WriteImage(fd, large_addrs[i],
+                                    large[i].npages * page_size))
+      return false;
+
+  return true;
+}
+
+/** * map the heap section of an image over this heap, a heap file's
+ ** checkpoint finds its pages already mapped **/
+bool Mapped::MapImage(Env &, int fd, bool pages) {
+  struct HeapImage image {};
+
+  if (!system::System::ReadImage(fd, &image, sizeof(image)) ||
+      image.n_pages > max_pages || image.nursery_bytes > image.base_bytes ||
+      image.base_bytes > image.heap_bytes ||
+      image.heap_bytes > image.n_pages * page_size)
+    return false;
+
+  if (image.n_pages > n_pages && !Grow((image.n_pages - n_pages) * page_size))
+    return false;
+
+  size_t objmap_words = (image.heap_bytes / sizeof(uint64_t) + 63) / 64;
+  std::vector<struct LargeImage> large(image.n_large);
+  std::vector<uint64_t> remember(image.n_remembered);
+
+  std::fill(objmap.begin(), objmap.end(), 0);
+  ClearMarks();
+
+  if (!system::System::ReadImage(fd, objmap.data(),
+                                 objmap_words * sizeof(uint64_t)) ||
+      !system::System::ReadImage(fd, large.data(),
+                                 large.size() * sizeof(struct LargeImage)) ||
+      !system::System::ReadImage(fd, remember.data(),
+                                 remember.size() * sizeof(uint64_t)))
+    return false;
+
+  off_t offset = lseek(fd, 0, SEEK_CUR);
+  if (offset < 0)
+    return false;
+
+  offset = (offset + page_size - 1) / page_size * page_size;
+
+  /* heap tags are offsets, the image maps anywhere */
+  size_t heap_pages = (image.heap_bytes + page_size - 1) / page_size;
+
+  if (pages) {
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    if (!system::System::MapImage(fd, offset, heap_pages,
+                                  reinterpret_cast<const char *>(heap_addr))
+             .has_value())
+      return false;
+
+    offset += heap_pages * page_size;
+  }
+
+  /* an image's old generation is the base, allocate past its last page */
+  nursery_end = heap_addr + image.nursery_bytes;
+  base_end = pages ? (heap_addr + image.heap_bytes + page_size - 1) /
+                         page_size * page_size
+                   : heap_addr + image.base_bytes;
+  old_barrier = pages ? base_end : heap_addr + image.heap_bytes;
+
+  for (auto &[addr, lo] : large_objects)
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    system::System::FreePages(reinterpret_cast<const char *>(addr),
+                              lo.npages);
+
+  large_objects.clear();
+  large_pages = 0;
+
+  /* large data lands somewhere new, point its vector at it. a heap
+     file rewrites its checkpoints, so that data is read, not mapped */
+  for (auto &lo : large) {
+    std::optional<const char *> addr =
+        pages ? system::System::MapImage(fd, offset, lo.npages, nullptr)
+              : system::System::AllocPages(lo.npages);
+    if (!addr.has_value())
+      return false;
+
+    if (!pages && (lseek(fd, offset, SEEK_SET) < 0 ||
+                   !system::System::ReadImage(
+                       fd, const_cast<char *>(addr.value()),
+                       lo.npages * page_size)))
+      return false;
+
+    offset += lo.npages * page_size;
+
+    bool base = IsBase(Map(lo.vector));
+
+    large_objects[reinterpret_cast<uint64_t>(addr.value())] = {lo.npages, base,
+                                                               base};
+    large_pages += lo.npages;
+
+    auto layout = reinterpret_cast<Vector::Layout *>(Map(lo.vector) + 1);
+    layout->offset =
+        Fixnum(heap_addr - reinterpret_cast<uint64_t>(addr.value())).tag_;
+  }
+
+  for (auto &blocks : free_blocks)
+    blocks.clear();
+
+  free_bytes = 0;
+  sweeping = false;
+  gc_tenured = 0;
+  ClearPages();
+
+  n_objects = image.n_objects;
+  std::copy(image.type_alloc, image.type_alloc + type_alloc->size(),
+            type_alloc->begin());
+
+  remembered.clear();
+  for (auto addr : remember) {
+    if (addr >= image.heap_bytes)
+      return false;
+
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    remembered.push_back(reinterpret_cast<HeapInfo *>(heap_addr + addr));
+  }
+
+  PinNursery();
+  ResetNursery();
+
+  /* the intern table is in the heap, count what it holds */
+  interned = image.interned;
+  n_interned = 0;
+  n_tombstones = 0;
+  MapInterned([this](Tag str) {
+    n_interned++;
+    return str;
+  });
+
+  return true;
+}
+
+/** * the old generation becomes base, returns the base's size **/
+size_t Mapped::Promote() {
+
+  /* nothing below the base is free */
+  while (Sweep(n_pages))
+    ;
+
+  for (auto &blocks : free_blocks)
+    blocks.clear();
+
+  free_bytes = 0;
+  ClearPages();
+
+  /* sweeps and compactions go a bitmap word at a time, align to one */
+  size_t align = 64 * sizeof(uint64_t);
+
+  base_end = (old_barrier + align - 1) / align * align;
+  old_barrier = base_end;
+
+  MapBase([this](HeapInfo *hinfo) {
+    if (SysClass(*hinfo) != SYS_CLASS::VECTOR)
+      return;
+
+    auto layout = reinterpret_cast<Vector::Layout *>(hinfo + 1);
+    auto large = FindLarge(reinterpret_cast<uint64_t>(
+        HeapAddr(Fixnum::Int64Of(layout->offset))));
+
+    if (large.has_value())
+      large.value()->second.base = large.value()->second.marked = true;
+  });
+
+  return base_end - nursery_end;
+}
+
+/** * back this heap with a heap file, npages of it are mapped over it **/
+bool Mapped::MapPersistent(int fd, uint64_t offset, size_t ceiling,
+                           size_t npages) {
+
+  if (ceiling < n_pages || npages > ceiling)
+    return false;
+
+  max_pages = std::min(max_pages, ceiling);
+
+  if (npages > n_pages && !Grow((npages - n_pages) * page_size))
+    return false;
+
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  return npages == 0 ||
+         system::System::MapImage(fd, offset, npages,
+                                  reinterpret_cast<const char *>(heap_addr))
+             .has_value();
+}
+
+/** * write stored into pages back to the heap file, all of them if all **/
+bool Mapped::SyncPages(int fd, uint64_t offset, bool all) {
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  auto addr = reinterpret_cast<const char *>(heap_addr);
+  auto dirty = all ? std::nullopt
+                   : system::System::PrivatePages(addr, n_pages);
+
+  /* without a page map, every page is written */
+  auto stored = [all, &dirty](size_t page) {
+    return all || !dirty.has_value() || dirty.value()[page];
+  };
+
+  for (size_t page = 0; page < n_pages;) {
+    if (!stored(page)) {
+      ++page;
+      continue;
+    }
+
+    size_t run = page + 1;
+    while (run < n_pages && stored(run))
+      ++run;
+
+    /* the file has the page now, drop our copy of it */
+    if (lseek(fd, static_cast<off_t>(offset + page * page_size), SEEK_SET) <
+            0 ||
+        !system::System::WriteImage(fd, addr + page * page_size,
+                                    (run - page) * page_size) ||
+        !system::System::MapImage(fd, offset + page * page_size, run - page,
+                                  addr + page * page_size)
+             .has_value())
+      return false;
+
+    page = run;
+  }
+
+  return true;
+}
+
+/** * heap resident roots **/
+void Mapped::GcRoots(const std::function<void(Tag &)> &fn) {
+
+  /* the table, not the strings in it */
+  fn(interned);
+}
+
+/** * bytes used by an object, or by the objects on a page **/
+size_t Mapped::RoomOf(HeapInfo *hinfo) {
+  size_t nbytes = 0;
+
+  if (!(RefBits(*hinfo) & GC_PAGE))
+    return Size(*hinfo);
+
+  MapPage(hinfo, [&nbytes, hinfo](HeapInfo *) {
+    nbytes += PageObjectSize(hinfo);
+  });
+
+  return nbytes;
 }
 
 /** * count up total data bytes in heap **/
 uint32_t Mapped::Room() {
-  uint32_t nbytes = 0;
+  uint32_t nbytes = LargeSize();
 
   heapinfo_iter iter(this);
   for (auto it = iter.begin(); it != iter.end(); it = ++iter)
-    nbytes += Size(*it);
+    nbytes += RoomOf(it);
 
   return nbytes;
 }
 
 /** * count up total type tag size **/
 uint32_t Mapped::Room(SYS_CLASS tag) {
-  uint32_t total_size = 0;
+  uint32_t total_size = tag == SYS_CLASS::VECTOR ? LargeSize() : 0;
 
   heapinfo_iter iter(this);
   for (auto it = iter.begin(); it != iter.end(); it = ++iter)
     if (tag == SysClass(*it))
-      total_size += Size(*it);
+      total_size += RoomOf(it);
 
   return total_size;
 }
 
+/** * commit another segment of the reserved heap **/
+bool Mapped::Grow(size_t nbytes) {
+  size_t need = (nbytes + page_size - 1) / page_size;
+  size_t grow = std::max(need, n_pages);
+
+  if (n_pages + need > max_pages)
+    return false;
+
+  grow = std::min(grow, max_pages - n_pages);
+
+  // NOLINTNEXTLINE(performance-no-int-to-ptr)
+  auto segment = reinterpret_cast<const char *>(heap_addr + HeapSize());
+  if (!system::System::CommitPages(segment, grow))
+    return false;
+
+  n_pages += grow;
+
+  objmap.resize(HeapSize() / sizeof(uint64_t) / 64, 0);
+  markmap.resize(objmap.size(), 0);
+
+  return true;
+}
+
 /** * heap object **/
-Mapped::Mapped(system::System &sys, int n_pages) : sys(sys), n_pages(n_pages) {
-  const char *heapId = "heap";
+Mapped::Mapped(system::System &sys, size_t max_pages)
+    : sys(sys), max_pages(std::clamp(max_pages, MIN_PAGES, MAX_PAGES)) {
 
   page_size = system::System::PAGESIZE;
+  n_pages = std::min(INITIAL_PAGES, this->max_pages);
+  retain = INITIAL_PAGES * page_size;
 
-  std::optional<const char *> addr = system::System::MapPages(n_pages, heapId);
+  /* reserve the ceiling, commit the initial segment */
+  std::optional<const char *> addr =
+      system::System::ReservePages(this->max_pages);
 
-  if (!addr.has_value())
+  if (!addr.has_value() ||
+      !system::System::CommitPages(addr.value(), n_pages))
     throw std::runtime_error("mmap failed");
 
   mapped_file_name = "";
 
+  /* the nursery is the bottom quarter of the initial segment */
   heap_addr = reinterpret_cast<uint64_t>(addr.value());
-  alloc_barrier = reinterpret_cast<size_t>(addr.value());
+  nursery_end = heap_addr + (n_pages / 4) * page_size;
+  old_barrier = nursery_end;
+  base_end = nursery_end;
+
+  objmap = std::vector<uint64_t>(HeapSize() / sizeof(uint64_t) / 64, 0);
+  markmap = std::vector<uint64_t>(objmap.size(), 0);
+
+  free_blocks = std::vector<std::vector<struct FreeBlock>>(N_CLASSES);
+  free_bytes = 0;
+  sweeping = false;
+
+  /* conses, symbols and functions are two, three and four tags */
+  class_pages = std::vector<struct ClassPages>(16, {0, {}, 0});
+  class_pages[std::to_underlying(SYS_CLASS::CONS)].nbytes = 2 * sizeof(Tag);
+  class_pages[std::to_underlying(SYS_CLASS::SYMBOL)].nbytes = 3 * sizeof(Tag);
+  class_pages[std::to_underlying(SYS_CLASS::FUNCTION)].nbytes =
+      4 * sizeof(Tag);
+
+  large_pages = 0;
+
+  n_objects = 0;
   type_free = std::make_unique<std::vector<int>>(16, 0);
   type_alloc = std::make_unique<std::vector<int>>(16, 0);
+
+  interned = Type::NIL;
+  n_interned = 0;
+  n_tombstones = 0;
+
+  n_carved = 0;
+
+  ResetNursery();
 }
 
 } /* namespace heap */
@@ -14,17 +14,24 @@
 #define LIBMU_HEAP_MAPPED_H_
 
 #include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cinttypes>
 #include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "libmu/core/heap.h"
 #include "libmu/core/type.h"
@@ -52,10 +59,161 @@ public:
 
   std::string mapped_file_name; /* mapped file */
   uint64_t heap_addr;           /* user virtual address */
-  uint64_t alloc_barrier;       /* alloc barrier */
-  int n_pages;                  /* number of pages in the heap */
+  uint64_t alloc_barrier;       /* nursery alloc barrier */
+  uint64_t alloc_limit;         /* end of the current nursery gap */
+  uint64_t nursery_end;         /* end of the nursery */
+  uint64_t old_barrier;         /* old generation alloc barrier */
+  uint64_t base_end;            /* end of the immortal image base */
+  size_t nursery_alloc;         /* bytes in use in the nursery */
+  size_t n_pages;               /* number of committed pages */
+  size_t max_pages;             /* heap ceiling, in pages */
+  size_t retain;                /* free bytes kept resident */
   int page_size;                /* page size for this heap */
 
+  /** * heaps grow in segments from a 4 MiB start, offsets stay 32 bits **/
+  static const size_t INITIAL_PAGES = 1024;
+  static const size_t MIN_PAGES = 64;
+  static const size_t MAX_PAGES = (size_t{1} << 20) - 1;
+
+  /** * nursery free space between pinned objects **/
+  std::vector<std::pair<uint64_t, uint64_t>> nursery_gaps;
+  size_t gap; /* current nursery gap */
+
+  /** * object start and mark bitmaps, one bit per heap word **/
+  std::vector<uint64_t> objmap;
+  std::vector<uint64_t> markmap;
+
+  /** * old generation free blocks, segregated by size class **/
+  struct FreeBlock {
+    HeapInfo *hinfo; /* block address */
+    size_t nbytes;   /* block size */
+  };
+
+  static const size_t N_EXACT = 32; /* exact fit classes, in words */
+  static const size_t N_CLASSES = 64;
+
+  std::vector<std::vector<FreeBlock>> free_blocks;
+  size_t free_bytes; /* total bytes on the free lists */
+
+  /** * lazy sweep state **/
+  bool sweeping;      /* old generation sweep in progress */
+  size_t sweep_word;  /* next mark bitmap word to sweep */
+  size_t sweep_limit; /* end of the sweep, in bitmap words */
+  uint64_t sweep_free; /* start of the current dead run */
+
+  /** * exact classes for small objects, powers of two after that **/
+  static size_t SizeClass(size_t nbytes) {
+    size_t nwords = nbytes / sizeof(uint64_t);
+
+    return nwords <= N_EXACT
+               ? nwords
+               : N_EXACT + std::bit_width(nwords) - std::bit_width(N_EXACT);
+  }
+
+  /** * large object space, vector data mapped on its own pages **/
+  struct LargeObject {
+    size_t npages; /* mapped pages */
+    bool marked;   /* its vector is live */
+    bool base;     /* its vector is in the base */
+  };
+
+  std::map<uint64_t, struct LargeObject> large_objects;
+  size_t large_pages; /* total large object pages */
+
+  /** * large object containing addr, if any **/
+  std::optional<decltype(large_objects)::iterator> FindLarge(uint64_t addr) {
+    auto large = large_objects.upper_bound(addr);
+
+    if (large == large_objects.begin())
+      return std::nullopt;
+
+    --large;
+    if (addr >= large->first + large->second.npages * page_size)
+      return std::nullopt;
+
+    return large;
+  }
+
+  /** * context allocation buffers, chunks start on an object bitmap word **/
+  static const size_t BUFFER_BYTES = 16 * 1024;
+  static const size_t BUFFER_ALIGN = 64 * sizeof(uint64_t);
+
+  std::vector<AllocBuffer *> buffers; /* attached buffers */
+  std::mutex alloc_lock;              /* nursery carving, shared allocation */
+  uint64_t n_carved;                  /* trips to the shared nursery */
+
+  void AttachBuffer(AllocBuffer &) override;
+  void DetachBuffer(AllocBuffer &) override;
+
+  void OpenArena(Arena &) override;
+  bool CloseArena(Arena &) override;
+
+  /** * header-free pages, objects of one class and size after a header
+   ** and the object size. a class's pages with free objects are kept
+   ** on its list, the allocator works down the one on top. **/
+  static const size_t PAGE_OBJECTS = 2 * sizeof(uint64_t); /* first object */
+
+  struct ClassPages {
+    size_t nbytes;                 /* object size, 0 if not paged */
+    std::vector<HeapInfo *> pages; /* pages with free objects */
+    size_t next;                   /* next object to try on the top page */
+  };
+
+  std::vector<struct ClassPages> class_pages;
+
+  /** * the page an address is on, if it's a class page **/
+  std::optional<HeapInfo *> PageOf(uint64_t addr) {
+    uint64_t page = addr & ~(uint64_t(page_size) - 1);
+
+    if (page < nursery_end || page >= old_barrier)
+      return std::nullopt;
+
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    auto hinfo = reinterpret_cast<HeapInfo *>(page);
+    if (!IsObject(hinfo) || !(RefBits(*hinfo) & GC_PAGE))
+      return std::nullopt;
+
+    return hinfo;
+  }
+
+  /** * does a live class page start at this bitmap word? **/
+  bool IsPageWord(size_t word) {
+    if (word % (page_size / sizeof(uint64_t) / 64) || !(objmap[word] & 1))
+      return false;
+
+    // NOLINTNEXTLINE(performance-no-int-to-ptr)
+    return RefBits(*reinterpret_cast<HeapInfo *>(
+               heap_addr + word * 64 * sizeof(uint64_t))) &
+           GC_PAGE;
+  }
+
+  /** * a page object's header is its page's **/
+  HeapInfo *HeaderOf(HeapInfo *hinfo) override {
+    std::optional<HeapInfo *> page =
+        PageOf(reinterpret_cast<uint64_t>(hinfo));
+
+    return page.has_value() ? page.value() : hinfo;
+  }
+
+  size_t PageCapacity(HeapInfo *page) {
+    return (page_size - PAGE_OBJECTS) / PageObjectSize(page);
+  }
+
+  void MapPage(HeapInfo *page,
+               const std::function<void(HeapInfo *)> &fn) override {
+    size_t nbytes = PageObjectSize(page);
+    uint64_t addr = reinterpret_cast<uint64_t>(page) + PAGE_OBJECTS -
+                    sizeof(HeapInfo);
+
+    for (size_t nth = 0; nth < PageCapacity(page); ++nth, addr += nbytes) {
+      size_t index = (addr - heap_addr) / sizeof(uint64_t);
+
+      if ((objmap[index / 64] >> (index % 64)) & 1)
+        // NOLINTNEXTLINE(performance-no-int-to-ptr)
+        fn(reinterpret_cast<HeapInfo *>(addr));
+    }
+  }
+
   int n_objects; /* number of objects in the heap */
   std::unique_ptr<std::vector<int>> type_alloc; /* allocated type counts */
   std::unique_ptr<std::vector<int>> type_free;  /* free type counts */
@@ -63,29 +221,60 @@ public:
 public:
   uint32_t HeapSize() override { return page_size * n_pages; }
   uint32_t HeapAlloc() override {
-    return alloc_barrier - reinterpret_cast<uint64_t>(heap_addr);
+    MergeBuffer();
+    return nursery_alloc + (old_barrier - nursery_end) - free_bytes;
+  }
+
+  size_t HeapMapped() override { return HeapSize() + LargeSize(); }
+  size_t HeapResident() override;
+  void Retain(size_t nbytes) override { retain = nbytes; }
+  bool Grow(size_t) override;
+
+  size_t NurseryAlloc() override {
+    MergeBuffer();
+    return nursery_alloc;
+  }
+  size_t OldRoom() override {
+    return heap_addr + HeapSize() - old_barrier + free_bytes;
   }
 
   int TypeAlloc(Type::SYS_CLASS sys_class) override {
+    MergeBuffer();
     return type_alloc->at(std::to_underlying(sys_class));
   }
 
   int TypeAlloc() override {
+    MergeBuffer();
     return std::accumulate(type_alloc->begin(), type_alloc->end(), size_t{0},
                            std::plus<>());
   }
 
-  std::unordered_map<Tag, Tag> interned_strings{};
+  /** * weak string intern table, a heap vector of (hash, string) pairs
+   ** probed linearly. the collector doesn't trace the strings, it drops
+   ** the ones nothing else keeps alive. **/
+  struct Interned {
+    uint64_t hash; /* cached string hash */
+    Tag str;       /* string, or an empty or removed slot */
+  };
+
+  static const size_t INTERN_MIN = 256; /* smallest table, in slots */
 
-  std::optional<Tag> MapString(std::string &) override;
+  Tag interned;        /* the table, :nil until the first string */
+  size_t n_interned;   /* strings in the table */
+  size_t n_tombstones; /* removed slots still probed past */
+  std::mutex intern_lock;
+
+  std::optional<Tag> MapString(const char *, size_t) override;
   Tag InternString(Env &, Tag str) override;
+  void MapInterned(const std::function<std::optional<Tag>(Tag)> &) override;
 
+  size_t RoomOf(HeapInfo *);
   uint32_t Room() override;
   uint32_t Room(Type::SYS_CLASS) override;
 
   /** * maps **/
   HeapInfo *Map(Tag ptr) override {
-    return reinterpret_cast<HeapInfo *>(HeapAddr(Type::IndirectData(ptr) - 1));
+    return reinterpret_cast<HeapInfo *>(HeapAddr(Type::IndirectData(ptr))) - 1;
   }
 
   void Map(std::function<void(HeapInfo *)> fn) override {
@@ -101,22 +290,191 @@ public:
     return reinterpret_cast<void *>(heap_addr - offset);
   }
 
+  bool IsHeapAddr(const void *ptr) override {
+    auto addr = reinterpret_cast<uint64_t>(ptr);
+
+    return (addr >= heap_addr && addr < heap_addr + HeapSize()) ||
+           FindLarge(addr).has_value();
+  }
+
+  /** * object start bitmap **/
+  bool IsObject(HeapInfo *hinfo) override {
+    auto addr = reinterpret_cast<uint64_t>(hinfo);
+
+    if (addr < heap_addr || addr >= old_barrier || addr % sizeof(uint64_t))
+      return false;
+
+    size_t index = (addr - heap_addr) / sizeof(uint64_t);
+    return (objmap[index / 64] >> (index % 64)) & 1;
+  }
+
+  void SetObject(HeapInfo *hinfo, bool object) {
+    size_t index =
+        (reinterpret_cast<uint64_t>(hinfo) - heap_addr) / sizeof(uint64_t);
+
+    if (object)
+      objmap[index / 64] |= uint64_t{1} << (index % 64);
+    else
+      objmap[index / 64] &= ~(uint64_t{1} << (index % 64));
+  }
+
+  /** * mark bitmap **/
+  bool IsMarked(HeapInfo *hinfo) override {
+    size_t index =
+        (reinterpret_cast<uint64_t>(hinfo) - heap_addr) / sizeof(uint64_t);
+
+    return (markmap[index / 64] >> (index % 64)) & 1;
+  }
+
+  bool Mark(HeapInfo *hinfo) override {
+    size_t index =
+        (reinterpret_cast<uint64_t>(hinfo) - heap_addr) / sizeof(uint64_t);
+    uint64_t bit = uint64_t{1} << (index % 64);
+
+    if (markmap[index / 64] & bit)
+      return false;
+
+    markmap[index / 64] |= bit;
+
+    /* a page lives while anything on it does */
+    HeapInfo *page = HeaderOf(hinfo);
+    if (page != hinfo)
+      Mark(page);
+
+    return true;
+  }
+
+  void ClearMarks() override {
+    std::memset(markmap.data(), 0, markmap.size() * sizeof(uint64_t));
+
+    for (auto &[addr, large] : large_objects)
+      large.marked = large.base;
+  }
+
+  bool MarkLarge(uint64_t addr) override {
+    auto large = FindLarge(addr);
+
+    if (!large.has_value() || large.value()->second.marked)
+      return false;
+
+    large.value()->second.marked = true;
+    return true;
+  }
+
+  size_t LargeSize() override { return large_pages * page_size; }
+
+  HeapInfo *NextObject(uint64_t);
+  std::optional<HeapInfo *> MapInterior(uint64_t) override;
+
+  bool IsNursery(HeapInfo *hinfo) override {
+    auto addr = reinterpret_cast<uint64_t>(hinfo);
+
+    return addr >= heap_addr && addr < nursery_end;
+  }
+
+  /** * the image base sits at the bottom of the old generation **/
+  bool IsBase(HeapInfo *hinfo) override {
+    auto addr = reinterpret_cast<uint64_t>(hinfo);
+
+    return addr >= nursery_end && addr < base_end;
+  }
+
+  void MapBase(const std::function<void(HeapInfo *)> &fn) override {
+
+    for (HeapInfo *hinfo = NextObject(nursery_end);
+         hinfo != nullptr && IsBase(hinfo);
+         hinfo = NextObject(reinterpret_cast<uint64_t>(hinfo) + Size(*hinfo)))
+      fn(hinfo);
+  }
+
+  void MapDynamic(const std::function<void(HeapInfo *)> &fn) override {
+
+    for (HeapInfo *hinfo = NextObject(heap_addr); hinfo != nullptr;) {
+      if (IsBase(hinfo)) {
+        hinfo = NextObject(base_end);
+        continue;
+      }
+
+      fn(hinfo);
+      hinfo = NextObject(reinterpret_cast<uint64_t>(hinfo) + Size(*hinfo));
+    }
+  }
+
+  size_t Promote() override;
   size_t HeapInfoTag(HeapInfo *) override;
   std::optional<int64_t> Alloc(int, SYS_CLASS) override;
+  bool Alloc(int, SYS_CLASS, std::span<int64_t>) override;
+  std::optional<void *> LargeAlloc(size_t) override;
+  void SweepLarge() override;
+  std::optional<int64_t> Tenure(int, SYS_CLASS) override;
+  std::optional<HeapInfo *> Evacuate(HeapInfo *) override;
+  void Sweep() override;
+  bool Sweep(size_t) override;
+  void Compact(const std::function<void()> &) override;
+
+  /** * compact when a quarter of the old generation is free blocks **/
+  bool IsFragmented() override {
+    return !sweeping && free_bytes > (old_barrier - base_end) / 4;
+  }
+  void ResetNursery() override;
+  void GcRoots(const std::function<void(Tag &)> &) override;
+
+  explicit Mapped(system::System &, size_t);
+
+private: /* string interning */
+  std::string_view StringOf(Tag);
+  Interned *InternTable(Tag, size_t *);
+  Interned *FindInterned(uint64_t, const char *, size_t);
+  void Rehash(Env &);
+
+private: /* allocation buffers */
+  int64_t BufferAlloc(AllocBuffer &, size_t, SYS_CLASS);
+  void BufferAlloc(AllocBuffer &, size_t, SYS_CLASS, std::span<int64_t>);
+  std::optional<int64_t> SharedAlloc(size_t, SYS_CLASS);
+  bool Refill(AllocBuffer &, size_t);
+  void MergeBuffer(AllocBuffer &);
+  void MergeBuffer();
+  void RetireBuffers();
+  void KeepArenas(AllocBuffer &);
+  void ClearObjects(uint64_t, uint64_t);
+
+private: /* old generation */
+  std::optional<HeapInfo *> OldAlloc(size_t, SYS_CLASS);
+  std::optional<HeapInfo *> PageAlloc(struct ClassPages &, SYS_CLASS);
+  std::optional<HeapInfo *> NewPage(SYS_CLASS, size_t);
+  void ReusePage(HeapInfo *);
+  void ClearPages();
+  void Rebase(HeapInfo *, HeapInfo *);
+  void PinNursery();
+  std::optional<struct FreeBlock> FreeAlloc(size_t);
+  void AddFreeBlock(uint64_t, size_t);
+  void Release();
+
+public: /* image */
+  bool SaveImage(int, bool) override;
+  bool MapImage(Env &, int, bool) override;
+  bool MapPersistent(int, uint64_t, size_t, size_t) override;
+  bool SyncPages(int, uint64_t, bool) override;
+  size_t MaxPages() override { return max_pages; }
+
+private:
+  /** * heap section of an image file, page aligned heap and large pages
+   ** follow. a heap file's checkpoint leaves the heap pages out. **/
+  struct HeapImage {
+    uint64_t heap_bytes;    /* heap_addr to old_barrier */
+    uint64_t nursery_bytes; /* heap_addr to nursery_end */
+    uint64_t base_bytes;    /* heap_addr to base_end */
+    uint64_t n_pages;       /* committed pages */
+    Tag interned;           /* string intern table */
+    uint64_t n_large;       /* large objects, pages follow the heap */
+    uint64_t n_remembered;  /* old objects referencing the nursery */
+    int64_t n_objects;      /* metrics */
+    int32_t type_alloc[16];
+  };
 
-  explicit Mapped(system::System &, int);
-
-private: /* image */
-  struct CoreImage {
-    int img_size; /* size of entire image */
-    int hdr_size; /* size of the header */
-#if 0
-    std::string filename_; /* mapped file */
-    int hp_pagesz_;        /* page size for this heap */
-    int hp_npages_;        /* number of pages in the heap */
-    int hp_uaddr_;         /* user virtual address */
-    int hp_alloc_;         /* alloc barrier */
-#endif
+  struct LargeImage {
+    Tag vector;     /* owning vector */
+    uint64_t npages; /* mapped pages */
   };
 
 public: /* iterator */
@@ -129,10 +487,8 @@ public: /* iterator */
     iterator current;
 
     heapinfo_iter(Mapped *heap)
-        // NOLINTNEXTLINE (performance-no-int-to-ptr)
-        : heap(heap), heapinfo(reinterpret_cast<HeapInfo *>(heap->heap_addr)),
-          // NOLINTNEXTLINE (performance-no-int-to-ptr)
-          current(reinterpret_cast<HeapInfo *>(heap->heap_addr)) {}
+        : heap(heap), heapinfo(heap->NextObject(heap->heap_addr)),
+          current(heapinfo) {}
 
     iterator begin() { return heapinfo; }
     iterator end() { return nullptr; }
@@ -142,10 +498,8 @@ public: /* iterator */
     }
 
     iterator &operator++() { /* ++operator */
-      current += Size(*current) / sizeof(HeapInfo);
-      // NOLINTNEXTLINE (performance-no-int-to-ptr)
-      if (current >= reinterpret_cast<HeapInfo *>(heap->alloc_barrier))
-        current = nullptr;
+      current = heap->NextObject(reinterpret_cast<uint64_t>(current) +
+                                 Size(*current));
 
       return *&current;
     }
@@ -15,6 +15,7 @@
 #include <cassert>
 #include <cstdint>
 #include <cstdio>
+#include <cstdlib>
 #include <functional>
 #include <memory>
 
@@ -154,10 +155,50 @@ uint64_t mu_eval(void *ctx, uint64_t form) {
       context, core::Compile::Form(context, static_cast<Type::Tag>(form))));
 }
 
-/** * main thread context **/
-void *mu_context(int sin, int sout, int serr, char **, int) {
+/** * the caller is idle, catch up on deferred work **/
+void mu_idle(void *ctx) {
+  auto ctxt = reinterpret_cast<Context *>(ctx);
+
+  core::Heap::GcIdle(ctxt->env);
+}
+
+/** * main thread context, heap ceiling in MiB, optional image, heap file **/
+void *mu_context(int sin, int sout, int serr, char **, int, size_t heap_mb,
+                 const char *image, const char *heap_file) {
+  static const size_t DEFAULT_HEAP_MB = 1024;
+
+  /* the caller's ceiling wins over the process environment */
+  if (heap_mb == 0) {
+    const char *env_mb = getenv("MU_HEAP_SIZE");
+
+    if (env_mb != nullptr)
+      heap_mb = strtoul(env_mb, nullptr, 10);
+  }
+
+  if (heap_mb == 0)
+    heap_mb = DEFAULT_HEAP_MB;
+
   auto system = new system::System(sin, sout, serr);
-  Env *env = new Env(*system);
+  size_t heap_pages = heap_mb * (1024 * 1024 / system::System::PAGESIZE);
+  Env *env = nullptr;
+
+  if (image == nullptr)
+    env = new Env(*system, heap_pages);
+  else
+    try {
+      env = new Env(*system, heap_pages, image);
+    } catch (const std::exception &) {
+      return nullptr;
+    }
+
+  if (heap_file != nullptr && !env->OpenHeap(heap_file))
+    return nullptr;
+
+  /* free heap memory kept resident after a collection, in MiB */
+  const char *retain_mb = getenv("MU_HEAP_RETAIN");
+
+  if (retain_mb != nullptr)
+    env->heap->Retain(strtoul(retain_mb, nullptr, 10) * 1024 * 1024);
 
   return static_cast<void *>(new core::Context(*env, Type::NIL));
 }
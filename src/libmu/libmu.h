@@ -32,7 +32,9 @@ uint64_t mu_read_cstr(void *, const char *);
 void mu_write(void *, uint64_t, uint64_t, bool);
 void mu_writeln(void *, uint64_t, uint64_t, bool);
 bool mu_with_exception(void *, bool, const std::function<void(void *)> &);
-void *mu_context(int, int, int, char *argv[], int);
+void *mu_context(int, int, int, char *argv[], int, size_t, const char *,
+                 const char *);
+void mu_idle(void *);
 }
 
 } /* namespace api */
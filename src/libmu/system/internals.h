@@ -83,8 +83,22 @@ public: /* accessors */
 
 public: /* image mmap */
   static const int PAGESIZE = 4096;
-  static std::optional<const char *> MapPages(unsigned, const char *);
-  static bool SaveImage(System &, std::string);
+  static std::optional<const char *> ReservePages(unsigned);
+  static bool CommitPages(const char *, unsigned);
+  static std::optional<const char *> AllocPages(size_t);
+  static void FreePages(const char *, size_t);
+  static void ReleasePages(const char *, size_t);
+  static size_t ResidentPages(const char *, size_t);
+  static std::optional<const char *> MapImage(int, size_t, size_t,
+                                              const char *);
+  static bool WriteImage(int, const void *, size_t);
+  static bool ReadImage(int, void *, size_t);
+  static std::optional<std::vector<bool>> PrivatePages(const char *, size_t);
+  static bool ResizeFile(int, size_t);
+  static bool SyncFile(int);
+
+public: /* thread stack */
+  static std::optional<const char *> StackBase();
 
 public:
   [[noreturn]] static void Exit(int64_t);
@@ -86,6 +86,20 @@ public:
 
   void Close();
 
+  /** * image support, a stream outlives its process only by copy **/
+  int Flags() const { return flags; }
+
+  std::string Contents() const {
+    assert(IsString());
+
+    if (IsOutput())
+      return sstream->str();
+
+    /* what is left to read */
+    auto pos = sstream->tellg();
+    return pos < 0 ? std::string() : sstream->str().substr(pos);
+  }
+
   std::optional<int> ReadByte() const;
   std::optional<int> UnReadByte(int) const;
   bool WriteByte(int) const;
@@ -96,6 +110,7 @@ public:
   static std::optional<Stream *> OpenOutputString(const std::string &);
 
   static Stream *OpenStandardStream(STD_STREAM, int fd);
+  static Stream *OpenClosed(int);
 
   Stream(std::istream *is, int flags) : istream(is), flags(flags) {}
   Stream(std::ostream *os, int flags) : ostream(os), flags(flags) {}
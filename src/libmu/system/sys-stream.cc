@@ -186,6 +186,14 @@ Stream *Stream::OpenStandardStream(STD_STREAM stream, int fd) {
   }
 }
 
+/** * a closed stream stands in for one that can't be reopened **/
+Stream *Stream::OpenClosed(int flags) {
+
+  return new Stream(new std::stringstream(),
+                    (flags & (STREAM_INPUT | STREAM_OUTPUT)) | STREAM_STRING |
+                        STREAM_CLOSED);
+}
+
 void Stream::Close() {
   if (flags & STREAM_STD)
     return;
@@ -10,6 +10,7 @@
  ** system.cc: libmu system functions
  **
  **/
+#include <algorithm>
 #include <cassert>
 #include <cerrno>
 #include <climits>
@@ -22,6 +23,7 @@
 #include <iostream>
 #include <netinet/in.h>
 #include <optional>
+#include <pthread.h>
 #include <sys/mman.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -38,35 +40,90 @@ extern char **environ;
 namespace libmu {
 namespace system {
 
-/** * map pages in system address space **/
-std::optional<const char *> System::MapPages(unsigned npages,
-                                             const char *heapId) {
-  char *base;
-  int fd, seek;
-  char tmpfn[PATH_MAX];
+/** * reserve address space without backing it **/
+std::optional<const char *> System::ReservePages(unsigned npages) {
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
 
-  strcpy(tmpfn, "/var/tmp/lambda-");
-  strcat(tmpfn, heapId);
-  strcat(tmpfn, "-XXXXXX");
+#if defined(MAP_NORESERVE)
+  flags |= MAP_NORESERVE;
+#endif
 
-  fd = mkstemp(tmpfn);
-  if (fd < 0)
+  auto base = static_cast<char *>(
+      mmap(nullptr, size_t{npages} * PAGESIZE, PROT_NONE, flags, -1, 0));
+
+  if (base == MAP_FAILED)
     return std::nullopt;
 
-  seek = ftruncate(fd, npages * PAGESIZE);
-  if (seek < 0)
+  return base;
+}
+
+/** * make reserved pages usable **/
+bool System::CommitPages(const char *addr, unsigned npages) {
+
+  return mprotect(const_cast<char *>(addr), size_t{npages} * PAGESIZE,
+                  PROT_READ | PROT_WRITE) == 0;
+}
+
+/** * map anonymous pages on their own **/
+std::optional<const char *> System::AllocPages(size_t npages) {
+  auto base = static_cast<char *>(mmap(nullptr, npages * PAGESIZE,
+                                       PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+
+  if (base == MAP_FAILED)
     return std::nullopt;
 
-  base = (char *)mmap(nullptr, npages * PAGESIZE, PROT_READ | PROT_WRITE,
-                      MAP_PRIVATE, fd, 0);
+  return base;
+}
+
+/** * give pages back to the system **/
+void System::FreePages(const char *addr, size_t npages) {
+
+  munmap(const_cast<char *>(addr), npages * PAGESIZE);
+}
+
+/** * drop page contents, the pages stay mapped **/
+void System::ReleasePages(const char *addr, size_t npages) {
 
-  if (base == (char *)-1)
+  madvise(const_cast<char *>(addr), npages * PAGESIZE, MADV_DONTNEED);
+}
+
+/** * count resident pages **/
+size_t System::ResidentPages(const char *addr, size_t npages) {
+#if defined(__APPLE__)
+  std::vector<char> resident(npages);
+#else
+  std::vector<unsigned char> resident(npages);
+#endif
+
+  if (mincore(const_cast<char *>(addr), npages * PAGESIZE, resident.data()) <
+      0)
+    return 0;
+
+  return std::count_if(resident.begin(), resident.end(),
+                       [](auto page) { return page & 1; });
+}
+
+/** * base (highest address) of the calling thread's stack **/
+std::optional<const char *> System::StackBase() {
+#if defined(__APPLE__)
+  return static_cast<const char *>(pthread_get_stackaddr_np(pthread_self()));
+#else
+  pthread_attr_t attr;
+  void *addr;
+  size_t size;
+
+  if (pthread_getattr_np(pthread_self(), &attr))
     return std::nullopt;
 
-  close(fd);
-  unlink(tmpfn);
+  if (pthread_attr_getstack(&attr, &addr, &size)) {
+    pthread_attr_destroy(&attr);
+    return std::nullopt;
+  }
 
-  return base;
+  pthread_attr_destroy(&attr);
+  return static_cast<const char *>(addr) + size;
+#endif
 }
 
 /** * get system clock time in microseconds **/
@@ -156,8 +213,99 @@ std::optional<const std::string> System::Chdir(const std::string path) {
   return path;
 }
 
-/** * errno **/
-bool System::SaveImage(System &, std::string) { return true; }
+/** * map image file pages, over addr if it isn't null **/
+std::optional<const char *> System::MapImage(int fd, size_t offset,
+                                             size_t npages, const char *addr) {
+  int flags = MAP_PRIVATE | (addr == nullptr ? 0 : MAP_FIXED);
+
+  auto base = static_cast<char *>(mmap(const_cast<char *>(addr),
+                                       npages * PAGESIZE,
+                                       PROT_READ | PROT_WRITE, flags, fd,
+                                       static_cast<off_t>(offset)));
+
+  if (base == MAP_FAILED)
+    return std::nullopt;
+
+  return base;
+}
+
+/** * pages copied on write since they were mapped from a file **/
+std::optional<std::vector<bool>> System::PrivatePages(const char *addr,
+                                                      size_t npages) {
+#if defined(__linux__)
+  /* pagemap: bit 63 present, bit 62 swapped, bit 61 file or shared */
+  int fd = open("/proc/self/pagemap", O_RDONLY);
+  if (fd < 0)
+    return std::nullopt;
+
+  std::vector<uint64_t> entries(npages);
+  auto offset = reinterpret_cast<uint64_t>(addr) / PAGESIZE * sizeof(uint64_t);
+  auto nbytes = npages * sizeof(uint64_t);
+
+  bool read = pread(fd, entries.data(), nbytes, static_cast<off_t>(offset)) ==
+              static_cast<ssize_t>(nbytes);
+  close(fd);
+
+  if (!read)
+    return std::nullopt;
+
+  std::vector<bool> pages(npages);
+  for (size_t i = 0; i < npages; ++i)
+    pages[i] = (entries[i] >> 62) & 1 ||
+               ((entries[i] >> 63) & 1 && !((entries[i] >> 61) & 1));
+
+  return pages;
+#else
+  (void)addr;
+  (void)npages;
+  return std::nullopt;
+#endif
+}
+
+/** * size a file, flush it to stable storage **/
+bool System::ResizeFile(int fd, size_t nbytes) {
+
+  return ftruncate(fd, static_cast<off_t>(nbytes)) == 0;
+}
+
+bool System::SyncFile(int fd) { return fsync(fd) == 0; }
+
+/** * image file io, all or nothing **/
+bool System::WriteImage(int fd, const void *buf, size_t nbytes) {
+  auto src = static_cast<const char *>(buf);
+
+  while (nbytes > 0) {
+    ssize_t n = write(fd, src, nbytes);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+
+    src += n;
+    nbytes -= n;
+  }
+
+  return true;
+}
+
+bool System::ReadImage(int fd, void *buf, size_t nbytes) {
+  auto dst = static_cast<char *>(buf);
+
+  while (nbytes > 0) {
+    ssize_t n = read(fd, dst, nbytes);
+    if (n <= 0) {
+      if (n < 0 && errno == EINTR)
+        continue;
+      return false;
+    }
+
+    dst += n;
+    nbytes -= n;
+  }
+
+  return true;
+}
 
 /** * errno **/
 int System::Errno() { return errno; }
@@ -12,7 +12,10 @@
  **/
 #include "libmu/type/cons.h"
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <span>
 
 #include "libmu/core/env.h"
 #include "libmu/core/heap.h"
@@ -77,6 +80,38 @@ Tag unpack_cdr(Tag tag) {
   return unpack_car(Tag((tag_bits << 33) | static_cast<uint64_t>(sext) << 63));
 }
 
+/** * cons the first n elements of src onto tail. heap conses are
+ ** allocated in runs, so a list's cells are mostly adjacent. **/
+Tag list_onto(Env &env, const std::vector<Tag> &src, size_t n, Tag tail) {
+  std::array<int64_t, 64> cells{};
+
+  /* the end of a list may pack into immediates */
+  for (; n; --n) {
+    std::optional<Tag> immediate = Cons::Immediate(src[n - 1], tail);
+    if (!immediate.has_value())
+      break;
+
+    tail = immediate.value();
+  }
+
+  while (n) {
+    std::span<int64_t> run(cells.data(), std::min(n, cells.size()));
+
+    if (!Heap::GcAlloc(env, sizeof(Cons::Layout), Type::SYS_CLASS::CONS, run))
+      throw std::runtime_error("heap exhausted");
+
+    for (auto cell = run.rbegin(); cell != run.rend(); ++cell) {
+      Tag cons =
+          Type::Entag(*cell, Type::SYS_CLASS::CONS, Type::TAG::INDIRECT);
+
+      *Heap::Layout<Cons::Layout>(env, cons) = {src[--n], tail};
+      tail = cons;
+    }
+  }
+
+  return tail;
+}
+
 } /* anonymous namespace */
 
 bool Cons::IsType(Tag ptr) {
@@ -86,25 +121,30 @@ bool Cons::IsType(Tag ptr) {
 
 bool Cons::IsList(Tag ptr) { return Null(ptr) || IsType(ptr); }
 
-Tag Cons::Heap(Env &env) {
+/** * pack car and cdr into an immediate cons, if they fit **/
+std::optional<Tag> Cons::Immediate(Tag car, Tag cdr) {
+  /* these are 31 bit values */
+  std::optional<uint32_t> pcar = pack(car);
+  std::optional<uint32_t> pcdr = pack(cdr);
 
-  std::optional<uint64_t> packed = ([](Layout cons) -> std::optional<uint64_t> {
-    /* these are 31 bit values */
-    std::optional<uint32_t> car = pack(cons.car);
-    std::optional<uint32_t> cdr = pack(cons.cdr);
+  if (pcar.has_value() && pcdr.has_value())
+    return Entag(static_cast<uint64_t>((static_cast<uint64_t>(pcar.value())
+                                        << 33) |
+                                       (pcdr.value() << 2)),
+                 TAG::CONS);
 
-    if (car.has_value() && cdr.has_value())
-      return static_cast<uint64_t>((static_cast<uint64_t>(car.value()) << 33) |
-                                   (cdr.value() << 2));
+  return std::nullopt;
+}
 
-    return std::nullopt;
-  })(cons_);
+Tag Cons::Heap(Env &env) {
 
-  if (packed.has_value()) {
-    assert(Type::Eq(cons_.car, car(env, Entag(packed.value(), TAG::CONS))));
-    assert(Type::Eq(cons_.cdr, cdr(env, Entag(packed.value(), TAG::CONS))));
+  std::optional<Tag> immediate = Immediate(cons_.car, cons_.cdr);
 
-    return Entag(packed.value(), TAG::CONS);
+  if (immediate.has_value()) {
+    assert(Type::Eq(cons_.car, car(env, immediate.value())));
+    assert(Type::Eq(cons_.cdr, cdr(env, immediate.value())));
+
+    return immediate.value();
   }
 
   std::optional<size_t> alloc =
@@ -136,33 +176,13 @@ Tag Cons::cdr(Env &env, Tag cp) {
                                           : unpack_cdr(cp));
 }
 
-/** * garbage collection **/
-void Cons::Gc(Env &env, Tag ptr) {
-  assert(IsType(ptr));
-
-  if (Type::IsIndirect(ptr)) {
-    if (Env::IsGcMarked(env, ptr))
-      return;
-
-    Env::GcMark(env, ptr);
-  }
-
-  Env::Gc(env, car(env, ptr));
-  Env::Gc(env, cdr(env, ptr));
-}
-
 /** * make a list from a std::vector **/
 Tag Cons::List(Env &env, const std::vector<Tag> &src) {
 
   if (src.size() == 0)
     return NIL;
 
-  Tag rlist = NIL;
-
-  for (int nth = src.size(); nth; --nth)
-    rlist = Cons(src[nth - 1], rlist).Heap(env);
-
-  return rlist;
+  return list_onto(env, src, src.size(), NIL);
 }
 
 /** * make a dotted list from a std::vector<Tag> **/
@@ -171,13 +191,7 @@ Tag Cons::ListDot(Env &env, const std::vector<Tag> &src) {
   if (src.size() == 0)
     return NIL;
 
-  Tag rlist = Cons(src[src.size() - 2], src[src.size() - 1]).Heap(env);
-
-  if (src.size() > 2)
-    for (int nth = src.size() - 2; nth != 0; --nth)
-      rlist = Cons(src[nth - 1], rlist).Heap(env);
-
-  return rlist;
+  return list_onto(env, src, src.size() - 1, src.back());
 }
 
 /** * nth element of list **/
@@ -16,6 +16,7 @@
 #include <cassert>
 #include <functional>
 #include <memory>
+#include <optional>
 
 #include "libmu/core/env.h"
 #include "libmu/core/heap.h"
@@ -47,6 +48,8 @@ public: /* tag */
   static bool IsType(Tag);
   static bool IsList(Tag);
 
+  static std::optional<Tag> Immediate(Tag, Tag);
+
   static Tag List(Env &, const std::vector<Tag> &);
   static Tag ListDot(Env &, const std::vector<Tag> &);
 
@@ -56,8 +59,6 @@ public: /* tag */
   static void Write(Env &, Tag, Tag, bool);
   static Tag Read(Env &, Tag);
 
-  static void Gc(Env &, Tag);
-
 public: /* type model */
   Tag Heap(Env &) override;
 
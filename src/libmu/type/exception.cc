@@ -30,7 +30,7 @@ using Heap = core::Heap;
 
 namespace type {
 Tag Exception::Heap(Env &env) {
-  auto alloc = env.heap->Alloc(sizeof(Layout), SYS_CLASS::EXCEPTION);
+  auto alloc = Heap::GcAlloc(env, sizeof(Layout), SYS_CLASS::EXCEPTION);
 
   if (!alloc.has_value())
     throw std::runtime_error("heap exhausted");
@@ -41,19 +41,6 @@ Tag Exception::Heap(Env &env) {
   return tag;
 }
 
-/** * garbage collection **/
-void Exception::Gc(Env &env, Tag exception) {
-  assert(IsType(exception));
-
-  if (Env::IsGcMarked(env, exception))
-    return;
-
-  Env::GcMark(env, exception);
-
-  Env::Gc(env, source(env, exception));
-  Env::Gc(env, tag(env, exception));
-}
-
 /** * make view of exception **/
 Tag Exception::View(Env &env, Tag ex) {
   assert(IsType(ex));
@@ -81,7 +81,6 @@ public: /* type model */
   Tag Heap(Env &) override;
 
 public: /* object */
-  static void Gc(Env &, Tag);
   static Tag View(Env &, Tag);
 
   [[noreturn]] static void Raise(Env &, const std::string &,
@@ -95,6 +94,7 @@ public: /* object */
     exception_.eclass = Symbol::Keyword(eclass);
     exception_.etype = Symbol::Keyword(etype);
     exception_.source = source;
+    exception_.frame = NIL;
     exception_.tag = Symbol::Keyword(tag);
   }
 
@@ -107,6 +107,7 @@ public: /* object */
     exception_.eclass = eclass;
     exception_.etype = etype;
     exception_.source = source;
+    exception_.frame = NIL;
     exception_.tag = tag;
   }
 
@@ -92,13 +92,14 @@ public: /* tag */
 
 public: /* type model */
   Tag Heap(Env &env) override {
-    auto alloc = env.heap->Alloc(sizeof(double), SYS_CLASS::DOUBLE);
+    auto alloc = Heap::GcAlloc(env, sizeof(double), SYS_CLASS::DOUBLE);
     if (!alloc.has_value())
       throw std::runtime_error("heap exhausted");
-    Layout *layout = reinterpret_cast<Layout *>(alloc.value());
 
-    layout->dbl = layout_.dbl;
-    return Entag(alloc.value(), SYS_CLASS::DOUBLE, TAG::INDIRECT);
+    Tag tag = Entag(alloc.value(), SYS_CLASS::DOUBLE, TAG::INDIRECT);
+    *Heap::Layout<Layout>(env, tag) = layout_;
+
+    return tag;
   }
 
 public: /* object */
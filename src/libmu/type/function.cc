@@ -36,19 +36,6 @@ bool Function::IsType(Tag ptr) {
   return Type::IsIndirect(ptr) && IndirectClass(ptr) == SYS_CLASS::FUNCTION;
 }
 
-/** * garbage collection **/
-void Function::Gc(Env &env, Tag ptr) {
-  assert(IsType(ptr));
-
-  if (Env::IsGcMarked(env, ptr))
-    return;
-
-  Env::GcMark(env, ptr);
-
-  Env::Gc(env, form(env, ptr));
-  Env::Gc(env, extension(env, ptr));
-}
-
 /** * function printer **/
 void Function::Write(Env &env, Tag fn, Tag stream, bool) {
   assert(IsType(fn));
@@ -104,7 +91,7 @@ Tag Function::View(Env &env, Tag fn) {
 
 /** * clone function object **/
 Tag Function::Heap(Env &env) {
-  auto alloc = env.heap->Alloc(sizeof(Layout), SYS_CLASS::FUNCTION);
+  auto alloc = Heap::GcAlloc(env, sizeof(Layout), SYS_CLASS::FUNCTION);
   if (!alloc.has_value())
     throw std::runtime_error("heap exhausted");
 
@@ -69,6 +69,7 @@ public: /* tag */
   static Tag set_form(Env &env, Tag fn, Tag form) {
     assert(IsType(fn));
 
+    Heap::WriteBarrier(env, fn, form);
     Heap::Layout<Layout>(env, fn)->form = form;
     return form;
   }
@@ -87,7 +88,6 @@ public: /* tag */
 
   static Tag Funcall(Env &, Tag, const std::vector<Tag> &);
 
-  static void Gc(Env &, Tag);
   static void Write(Env &, Tag, Tag, bool);
   static Tag View(Env &, Tag);
   static Tag Clone(Env &, Tag);
@@ -100,19 +100,27 @@ std::optional<Tag> Namespace::Map(Env &env, Tag ns, SCOPE scope, Tag name) {
   }
 }
 
-/** * garbage collect the namespace **/
-void Namespace::Gc(Env &env, Tag ptr) {
-  assert(IsType(ptr));
+/** * rebuild a namespace's symbol cache from its symbol lists **/
+void Namespace::Cache(Env &env, Tag ns) {
+  assert(IsType(ns));
+
+  env.ns_cache->add_ns_cache(ns);
 
-  if (Env::IsGcMarked(env, ptr))
-    return;
+  Cons::iter externs_iter(env, externs(env, ns));
+  for (auto it = externs_iter.begin(); it != externs_iter.end();
+       it = ++externs_iter) {
+    Tag sym = Cons::car(env, it);
 
-  Env::GcMark(env, ptr);
+    env.ns_cache->add_externs(ns, hash_id(env, Symbol::name(env, sym)), sym);
+  }
 
-  Env::Gc(env, name(env, ptr));
-  Env::Gc(env, import(env, ptr));
-  Env::Gc(env, externs(env, ptr));
-  Env::Gc(env, interns(env, ptr));
+  Cons::iter interns_iter(env, interns(env, ns));
+  for (auto it = interns_iter.begin(); it != interns_iter.end();
+       it = ++interns_iter) {
+    Tag sym = Cons::car(env, it);
+
+    env.ns_cache->add_interns(ns, hash_id(env, Symbol::name(env, sym)), sym);
+  }
 }
 
 /** * view of namespace object **/
@@ -178,7 +186,7 @@ void Namespace::Write(Env &env, Tag nsd, Tag stream, bool) {
 }
 
 Tag Namespace::Heap(Env &env) {
-  auto alloc = env.heap->Alloc(sizeof(Layout), SYS_CLASS::NAMESPACE);
+  auto alloc = Heap::GcAlloc(env, sizeof(Layout), SYS_CLASS::NAMESPACE);
   if (!alloc.has_value())
     throw std::runtime_error("heap exhausted");
 
@@ -85,19 +85,21 @@ public: /* tag */
   static void externs(Env &env, Tag ns, Tag value) {
     assert(IsType(ns));
 
+    Heap::WriteBarrier(env, ns, value);
     Heap::Layout<Layout>(env, ns)->externs = value;
   }
 
   static void interns(Env &env, Tag ns, Tag value) {
     assert(IsType(ns));
 
+    Heap::WriteBarrier(env, ns, value);
     Heap::Layout<Layout>(env, ns)->interns = value;
   }
 
   static Tag Intern(Env &, Tag, SCOPE, Tag, Tag);
   static std::optional<Tag> Map(Env &, Tag, SCOPE, Tag);
+  static void Cache(Env &, Tag);
 
-  static void Gc(Env &, Tag);
   static void Write(Env &, Tag, Tag, bool);
   static Tag Symbols(Env &, Tag);
   static Tag View(Env &, Tag);
@@ -144,7 +144,7 @@ Tag Stream::Close(Env &env, Tag sp) {
 }
 
 Tag Stream::Heap(Env &env) {
-  auto alloc = env.heap->Alloc(sizeof(Layout), SYS_CLASS::STREAM);
+  auto alloc = Heap::GcAlloc(env, sizeof(Layout), SYS_CLASS::STREAM);
   if (!alloc.has_value())
     throw std::runtime_error("heap exhausted");
 
@@ -50,6 +50,12 @@ public: /* tag */
     return Heap::Layout<Layout>(env, stream)->stream;
   }
 
+  static void stream(Env &env, Tag stream, system::Stream *sys_stream) {
+    assert(IsType(stream));
+
+    Heap::Layout<Layout>(env, stream)->stream = sys_stream;
+  }
+
   static Tag OpenInputFile(Env &env, const std::string &path) {
     auto stream = system::Stream::OpenInputFile(path);
 
@@ -76,21 +76,6 @@ Tag Symbol::ns(Env &env, Tag symbol) {
   //  return Null(ns) ? env.uninterned : ns;
 }
 
-/** * garbage collection **/
-void Symbol::Gc(Env &env, Tag ptr) {
-  assert(IsType(ptr));
-
-  if (IsKeyword(ptr) || Env::IsGcMarked(env, ptr))
-    return;
-
-  Env::GcMark(env, ptr);
-
-  assert(!IsKeyword(ptr));
-
-  Env::Gc(env, name(env, ptr));
-  Env::Gc(env, value(env, ptr));
-}
-
 /** * keywords **/
 Tag Symbol::Keyword(Tag name) {
   return MakeDirect(DirectData(name), DirectSize(name), DIRECT_CLASS::SYMBOL);
@@ -184,7 +169,7 @@ Tag Symbol::ParseSymbol(Env &env, std::string string) {
 
 /** evict symbol to heap0 **/
 Tag Symbol::Heap(Env &env) {
-  auto alloc = env.heap->Alloc(sizeof(Layout), SYS_CLASS::SYMBOL);
+  auto alloc = Heap::GcAlloc(env, sizeof(Layout), SYS_CLASS::SYMBOL);
   if (!alloc.has_value())
     throw std::runtime_error("heap exhausted");
 
@@ -68,8 +68,11 @@ public: /* tag */
   static Tag set_value(Env &env, Tag symbol, Tag value) {
     assert(IsType(symbol));
 
-    return IsKeyword(symbol) ? symbol
-                             : Heap::Layout<Layout>(env, symbol)->value = value;
+    if (IsKeyword(symbol))
+      return symbol;
+
+    Heap::WriteBarrier(env, symbol, value);
+    return Heap::Layout<Layout>(env, symbol)->value = value;
   }
 
   static Tag name(Env &env, Tag symbol) {
@@ -81,7 +84,6 @@ public: /* tag */
                : Heap::Layout<Layout>(env, symbol)->name;
   }
 
-  static void Gc(Env &, Tag);
   static bool IsBound(Env &, Tag);
   static bool IsUninterned(Env &, Tag);
   static void Write(Env &, Tag, Tag, bool);
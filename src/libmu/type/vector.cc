@@ -13,6 +13,7 @@
 #include "libmu/type/vector.h"
 
 #include <cassert>
+#include <cstring>
 #include <functional>
 
 #include "libmu/core/env.h"
@@ -35,9 +36,19 @@ namespace {
 
 template <typename T>
 Tag list_to_vec(Env &env, const std::function<bool(Env &, Tag)> &isType,
-                const std::function<T(Tag)> &unbox, Tag list) {
+                const std::function<T(Tag)> &unbox, Type::SYS_CLASS vtype,
+                Tag list) {
   assert(Cons::IsList(list));
-  std::vector<T> vec;
+
+  size_t length = 0;
+
+  Cons::iter count(env, list);
+  for (auto it = count.begin(); it != count.end(); it = ++count)
+    length++;
+
+  /* filled in place, there's no intermediate std::vector */
+  Tag vec = Vector::Alloc(env, vtype, length);
+  T *data = Vector::Data<T>(env, vec);
 
   Cons::iter iter(env, list);
   for (auto it = iter.begin(); it != iter.end(); it = ++iter) {
@@ -46,10 +57,56 @@ Tag list_to_vec(Env &env, const std::function<bool(Env &, Tag)> &isType,
     if (!isType(env, car))
       Exception::Raise(env, "sv-list", "error", "type", car);
 
-    vec.push_back(unbox(car));
+    *data++ = unbox(car);
+  }
+
+  return vec;
+}
+
+/** * size of a vector element **/
+size_t element_size(Type::SYS_CLASS vtype) {
+
+  switch (vtype) {
+  case Type::SYS_CLASS::BYTE:
+    [[fallthrough]];
+  case Type::SYS_CLASS::CHAR:
+    return sizeof(char);
+  case Type::SYS_CLASS::FLOAT:
+    return sizeof(float);
+  case Type::SYS_CLASS::FIXNUM:
+    [[fallthrough]];
+  case Type::SYS_CLASS::T:
+    return sizeof(Tag);
+  default:
+    throw std::runtime_error("vector type botch");
+  }
+}
+
+/** * allocate a vector, large data goes out of line **/
+Tag alloc_vector(Env &env, size_t nbytes, void **data) {
+  std::optional<void *> large = std::nullopt;
+
+  if (nbytes > Heap::LARGE_OBJECT) {
+    large = env.heap->LargeAlloc(nbytes);
+    if (!large.has_value())
+      throw std::runtime_error("heap exhausted");
   }
 
-  return Vector(vec).Heap(env);
+  std::optional<size_t> alloc = Heap::GcAlloc(
+      env, sizeof(Vector::Layout) + (large.has_value() ? 0 : nbytes),
+      Type::SYS_CLASS::VECTOR);
+
+  if (!alloc.has_value())
+    throw std::runtime_error("heap exhausted");
+
+  Tag vec = Type::Entag(alloc.value(), Type::SYS_CLASS::VECTOR,
+                        Type::TAG::INDIRECT);
+
+  *data = large.has_value() ? large.value()
+                            : reinterpret_cast<void *>(
+                                  Heap::Layout<Vector::Layout>(env, vec) + 1);
+
+  return vec;
 }
 
 } /* anonymous namespace */
@@ -94,47 +151,41 @@ Tag Vector::Slice(Env &env, Tag vec, Tag off, Tag len) {
     return Type::MakeDirect(bits & ~mask, length, DirectClass(vec));
   }
 
-  std::optional<size_t> alloc =
-      env.heap->Alloc(sizeof(Layout), SYS_CLASS::VECTOR);
+  size_t type_size = element_size(Vector::TypeOf(env, vec));
 
-  if (!alloc.has_value())
-    throw std::runtime_error("heap exhausted");
-
-  int type_size = 0;
-
-  switch (Vector::TypeOf(env, vec)) {
-  case SYS_CLASS::BYTE:
-    [[fallthrough]];
-  case SYS_CLASS::CHAR:
-    type_size = sizeof(char);
-    break;
-  case SYS_CLASS::FLOAT:
-    type_size = sizeof(float);
-    break;
-  case SYS_CLASS::FIXNUM:
-    [[fallthrough]];
-  case SYS_CLASS::T:
-    type_size = sizeof(Tag);
-    break;
-  default:
-    throw std::runtime_error("vector type botch");
-  }
+  /* slices are copies */
+  void *dst = nullptr;
+  Tag slice = alloc_vector(env, length * type_size, &dst);
+  Layout *nlayout = env.heap->Layout<Layout>(env, slice);
 
-  Layout *vlayout = Heap::Layout<Layout>(env, vec);
-  Layout *nlayout = env.heap->Layout<Layout>(
-      env, Entag(alloc.value(), SYS_CLASS::VECTOR, TAG::INDIRECT));
+  *nlayout = *Heap::Layout<Layout>(env, vec);
 
-  *nlayout = *vlayout;
+  std::memcpy(dst, Data<char>(env, vec) + offset * type_size,
+              length * type_size);
 
   nlayout->length = len;
-
-  auto dst = Data<Tag>(env, vec);
   nlayout->offset =
-      Fixnum(reinterpret_cast<size_t>(env.heap->HeapAddr(
-                 reinterpret_cast<size_t>(dst) + offset * type_size)))
+      Fixnum(reinterpret_cast<size_t>(
+                 env.heap->HeapAddr(reinterpret_cast<size_t>(dst))))
           .tag_;
 
-  return Entag(alloc.value(), SYS_CLASS::VECTOR, TAG::INDIRECT);
+  return slice;
+}
+
+/** * a vector of length elements, filled in place through Data **/
+Tag Vector::Alloc(Env &env, SYS_CLASS vtype, size_t length) {
+  void *dst = nullptr;
+  Tag vec = alloc_vector(env, length * element_size(vtype), &dst);
+  Layout *layout = env.heap->Layout<Layout>(env, vec);
+
+  layout->type = Type::MapClassSymbol(vtype);
+  layout->length = Fixnum(length).tag_;
+  layout->offset =
+      Fixnum(reinterpret_cast<size_t>(
+                 env.heap->HeapAddr(reinterpret_cast<size_t>(dst))))
+          .tag_;
+
+  return vec;
 }
 
 /** * list to vector **/
@@ -146,26 +197,40 @@ Tag Vector::ListToVector(Env &env, Tag vectype, Tag list) {
   switch (vtype) {
   case SYS_CLASS::T:
     return list_to_vec<Tag>(
-        env, [](Env &, Tag) { return true; }, [](Tag t) { return t; }, list);
+        env, [](Env &, Tag) { return true; }, [](Tag t) { return t; }, vtype,
+        list);
   case SYS_CLASS::FLOAT:
     return list_to_vec<float>(
         env, [](Env &, Tag t) { return Float::IsType(t); },
-        [](Tag t) { return Float::FloatOf(t); }, list);
+        [](Tag t) { return Float::FloatOf(t); }, vtype, list);
   case SYS_CLASS::FIXNUM:
     return list_to_vec<int64_t>(
         env, [](Env &, Tag t) { return Fixnum::IsType(t); },
-        [](Tag t) { return Fixnum::Int64Of(t); }, list);
+        [](Tag t) { return Fixnum::Int64Of(t); }, vtype, list);
   case SYS_CLASS::BYTE:
     return list_to_vec<uint8_t>(
         env,
         [](Env &, Tag t) -> bool {
           return Fixnum::IsType(t) && Fixnum::Int64Of(t) < 256;
         },
-        [](Tag t) { return static_cast<uint8_t>(Fixnum::Int64Of(t)); }, list);
-  case SYS_CLASS::CHAR:
-    return list_to_vec<char>(
-        env, [](Env &, Tag t) -> bool { return Char::IsType(t); },
-        [](Tag t) { return Char::UInt64Of(t); }, list);
+        [](Tag t) { return static_cast<uint8_t>(Fixnum::Int64Of(t)); },
+        vtype, list);
+  case SYS_CLASS::CHAR: {
+    /* strings can be direct or interned, they go through Heap */
+    std::string str;
+
+    Cons::iter iter(env, list);
+    for (auto it = iter.begin(); it != iter.end(); it = ++iter) {
+      Tag car = Cons::car(env, it);
+
+      if (!Char::IsType(car))
+        Exception::Raise(env, "sv-list", "error", "type", car);
+
+      str.push_back(Char::UInt64Of(car));
+    }
+
+    return Vector(str).Heap(env);
+  }
   default:
     throw std::runtime_error("vector type violation");
   }
@@ -249,27 +314,20 @@ Tag Vector::Heap(Env &env) {
     if (Fixnum::Int64Of(vector_.length) <= DIRECT_STR_MAX)
       return tag_;
 
-    std::optional<Tag> str = env.heap->MapString(interned_);
+    std::optional<Tag> str = env.heap->MapString(
+        reinterpret_cast<const char *>(Fixnum::Int64Of(vector_.offset)),
+        Fixnum::Int64Of(vector_.length));
     if (str.has_value())
       return str.value();
   }
 
-  int nbytes = Fixnum::Int64Of(vector_.length) * sizeof_;
-  std::optional<size_t> alloc =
-      env.heap->Alloc(sizeof(Layout) + nbytes, SYS_CLASS::VECTOR);
-
-  if (!alloc.has_value())
-    throw std::runtime_error("heap exhausted");
-
-  Layout *layout = env.heap->Layout<Layout>(
-      env, Entag(alloc.value(), SYS_CLASS::VECTOR, TAG::INDIRECT));
+  size_t nbytes = Fixnum::Int64Of(vector_.length) * sizeof_;
+  void *dst = nullptr;
+  Tag vec = alloc_vector(env, nbytes, &dst);
+  Layout *layout = env.heap->Layout<Layout>(env, vec);
 
   uint64_t data = Fixnum::Int64Of(vector_.offset);
 
-  void *dst = reinterpret_cast<void *>(
-      reinterpret_cast<char *>(layout) +
-      (Heap::HeapWords(sizeof(Layout) * sizeof(uint64_t))));
-
   std::memcpy(dst, reinterpret_cast<void *>(data), nbytes);
 
   vector_.offset = Fixnum(reinterpret_cast<size_t>(env.heap->HeapAddr(
@@ -278,8 +336,6 @@ Tag Vector::Heap(Env &env) {
 
   *layout = vector_;
 
-  Tag vec = Entag(alloc.value(), SYS_CLASS::VECTOR, TAG::INDIRECT);
-
   if (Type::MapSymbolClass(vector_.type) == SYS_CLASS::CHAR)
     env.heap->InternString(env, vec);
 
@@ -297,38 +353,6 @@ Tag Vector::View(Env &env, Tag vector) {
   return Vector(view).Heap(env);
 }
 
-/** * garbage collection **/
-/** * this is so wrong it makees my eyes water **/
-void Vector::Gc(Env &env, Tag vec) {
-  assert(IsType(vec));
-
-  if (!Type::IsDirect(vec)) {
-    switch (Vector::TypeOf(env, vec)) {
-    case SYS_CLASS::CHAR:
-    case SYS_CLASS::FIXNUM:
-      [[fallthrough]];
-    case SYS_CLASS::FLOAT:
-      break;
-    case SYS_CLASS::BYTE:
-      [[fallthrough]];
-    case SYS_CLASS::T: {
-      if (Env::IsGcMarked(env, vec))
-        return;
-
-      Env::GcMark(env, vec);
-
-      Vector::iter<Tag> iter(env, vec);
-      for (auto it = iter.begin(); it != iter.end(); it = ++iter)
-        Env::Gc(env, *it);
-
-      break;
-    }
-    default:
-      throw std::runtime_error("vector type botch");
-    }
-  }
-}
-
 /** * vector parser **/
 Tag Vector::Read(Env &env, Tag stream) {
   assert(Stream::IsType(stream));
@@ -43,8 +43,7 @@ public:
   Layout vector_;
   size_t sizeof_;
 
-  Tag tag_;              /* for direct strings */
-  std::string interned_; /* for string interning */
+  Tag tag_; /* for direct strings */
 
 public: /* string */
   static std::string StdStringOf(Env &env, Tag str) {
@@ -136,7 +135,7 @@ public: /* Tag */
     return Type::MapClassSymbol(TypeOf(env, vec));
   }
 
-  static void Gc(Env &, Tag);
+  static Tag Alloc(Env &, SYS_CLASS, size_t);
   static Tag Slice(Env &env, Tag, Tag, Tag);
   static Tag ListToVector(Env &, Tag, Tag);
   static void Write(Env &, Tag, Tag, bool);
@@ -150,7 +149,7 @@ public: /* type model */
   explicit Vector() = default;
   explicit Vector(Tag){};
 
-  explicit Vector(std::vector<Tag> src) {
+  explicit Vector(const std::vector<Tag> &src) {
     sizeof_ = sizeof(Tag);
 
     vector_.type = Type::MapClassSymbol(SYS_CLASS::T);
@@ -161,8 +160,6 @@ public: /* type model */
   explicit Vector(const std::string &src) {
     sizeof_ = sizeof(uint8_t);
 
-    interned_ = src;
-
     vector_.type = Type::MapClassSymbol(SYS_CLASS::CHAR);
     vector_.length = Fixnum(src.size()).tag_;
     vector_.offset = Fixnum(reinterpret_cast<size_t>(src.data())).tag_;
@@ -171,7 +168,7 @@ public: /* type model */
       tag_ = MakeDirect(src);
   }
 
-  explicit Vector(std::vector<char> src) {
+  explicit Vector(const std::vector<char> &src) {
     sizeof_ = sizeof(char);
 
     vector_.type = Type::MapClassSymbol(SYS_CLASS::CHAR);
@@ -184,7 +181,7 @@ public: /* type model */
       tag_ = MakeDirect(std::string(ssrc));
   }
 
-  explicit Vector(std::vector<float> src) {
+  explicit Vector(const std::vector<float> &src) {
     sizeof_ = sizeof(float);
 
     vector_.type = Type::MapClassSymbol(SYS_CLASS::FLOAT);
@@ -192,7 +189,7 @@ public: /* type model */
     vector_.offset = Fixnum(reinterpret_cast<size_t>(src.data())).tag_;
   }
 
-  explicit Vector(std::vector<double> src) {
+  explicit Vector(const std::vector<double> &src) {
     sizeof_ = sizeof(double);
 
     vector_.type = Type::MapClassSymbol(SYS_CLASS::DOUBLE);
@@ -200,7 +197,7 @@ public: /* type model */
     vector_.offset = Fixnum(reinterpret_cast<size_t>(src.data())).tag_;
   }
 
-  explicit Vector(std::vector<uint8_t> src) {
+  explicit Vector(const std::vector<uint8_t> &src) {
     sizeof_ = sizeof(uint8_t);
 
     vector_.type = Type::MapClassSymbol(SYS_CLASS::BYTE);
@@ -208,7 +205,7 @@ public: /* type model */
     vector_.offset = Fixnum(reinterpret_cast<size_t>(src.data())).tag_;
   }
 
-  explicit Vector(std::vector<int64_t> src) {
+  explicit Vector(const std::vector<int64_t> &src) {
     sizeof_ = sizeof(int64_t);
 
     vector_.type = Type::MapClassSymbol(SYS_CLASS::FIXNUM);
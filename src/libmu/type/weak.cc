@@ -0,0 +1,54 @@
+/********
+ **
+ **  SPDX-FileCopyrightText: Copyright 2017-2022 James M. Putnam
+ **  SPDX-License-Identifier: MIT
+ **
+ **/
+
+/********
+ **
+ **  weak.cc: weak references
+ **
+ **/
+#include "libmu/type/weak.h"
+
+#include <cassert>
+#include <vector>
+
+#include "libmu/core/env.h"
+#include "libmu/core/heap.h"
+#include "libmu/core/type.h"
+
+#include "libmu/type/vector.h"
+
+namespace libmu {
+
+using Tag = core::Type::Tag;
+using Heap = core::Heap;
+
+namespace type {
+
+Tag Weak::Heap(Env &env) {
+  auto alloc = Heap::GcAlloc(env, sizeof(Layout), SYS_CLASS::WEAK);
+
+  if (!alloc.has_value())
+    throw std::runtime_error("heap exhausted");
+
+  Tag tag = Entag(alloc.value(), SYS_CLASS::WEAK, TAG::INDIRECT);
+  *env.heap->Layout<Layout>(env, tag) = weak_;
+
+  return tag;
+}
+
+/** * make view of weak reference **/
+Tag Weak::View(Env &env, Tag weak) {
+  assert(IsType(weak));
+
+  std::vector<Tag> view =
+      std::vector<Tag>{key(env, weak), value(env, weak), live(env, weak)};
+
+  return Vector(view).Heap(env);
+}
+
+} /* namespace type */
+} /* namespace libmu */
@@ -0,0 +1,83 @@
+/********
+ **
+ **  SPDX-FileCopyrightText: Copyright 2017-2022 James M. Putnam
+ **  SPDX-License-Identifier: MIT
+ **
+ **/
+
+/********
+ **
+ **  weak.h: weak references
+ **
+ **/
+#if !defined(LIBMU_TYPE_WEAK_H_)
+#define LIBMU_TYPE_WEAK_H_
+
+#include <cassert>
+
+#include "libmu/core/env.h"
+#include "libmu/core/heap.h"
+#include "libmu/core/type.h"
+
+namespace libmu {
+
+using Heap = core::Heap;
+
+namespace type {
+
+/** * ephemerons: the value is held only as long as the key is reachable
+ ** by something else. a full collection breaks an ephemeron whose key
+ ** died, its key and value both become :nil. **/
+class Weak : public Type {
+public:
+  struct Layout {
+    Tag key;   /* weakly held */
+    Tag value; /* held while the key lives */
+    Tag live;  /* :t until broken */
+  };
+
+  Layout weak_;
+
+public:
+  static inline bool IsType(Tag ptr) {
+    return IsIndirect(ptr) && IndirectClass(ptr) == SYS_CLASS::WEAK;
+  }
+
+  /** * accessors **/
+  static Tag key(Env &env, Tag weak) {
+    assert(IsType(weak));
+
+    return Heap::Layout<Layout>(env, weak)->key;
+  }
+
+  static Tag value(Env &env, Tag weak) {
+    assert(IsType(weak));
+
+    return Heap::Layout<Layout>(env, weak)->value;
+  }
+
+  static Tag live(Env &env, Tag weak) {
+    assert(IsType(weak));
+
+    return Heap::Layout<Layout>(env, weak)->live;
+  }
+
+public: /* type model */
+  Tag Heap(Env &) override;
+
+public: /* object */
+  static Tag View(Env &, Tag);
+
+  explicit Weak(Tag key, Tag value) : Type() {
+    weak_.key = key;
+    weak_.value = value;
+    weak_.live = T;
+  }
+
+  ~Weak() override = default;
+};
+
+} /* namespace type */
+} /* namespace libmu */
+
+#endif /* LIBMU_TYPE_WEAK_H_ */
@@ -35,6 +35,28 @@ auto load(void *context, const char *filespec) -> void {
     libmu::api::mu_eval(context, libmu::api::mu_read_stream(context, istream));
 }
 
+/** * the heap ceiling, image and heap file precede the context **/
+auto option(int argc, char **argv, const std::string &flag) -> const char * {
+  for (int i = 1; i < argc; ++i) {
+    auto arg = std::string(argv[i]);
+
+    if (arg.starts_with(flag)) {
+      if (arg.size() > flag.size())
+        return argv[i] + flag.size();
+
+      return i + 1 < argc ? argv[i + 1] : nullptr;
+    }
+  }
+
+  return nullptr;
+}
+
+auto heap_size(int argc, char **argv) -> size_t {
+  auto mib = option(argc, argv, "-H");
+
+  return mib == nullptr ? 0 : strtoul(mib, nullptr, 10);
+}
+
 auto repl(void *context, int argc, char **argv) -> void {
   bool repl = argc == 1;
 
@@ -44,7 +66,7 @@ auto repl(void *context, int argc, char **argv) -> void {
         extern int optind;
 
         int opt;
-        while ((opt = getopt(argc, argv, "bvhe:q:l:")) != -1) {
+        while ((opt = getopt(argc, argv, "bvhe:q:l:H:i:p:")) != -1) {
           switch (opt) {
           case '?':
           case 'h': {
@@ -59,6 +81,9 @@ auto repl(void *context, int argc, char **argv) -> void {
                 "  -l SRCFILE           load SRCFILE in sequence\n"
                 "  -e SEXPR             evaluate SEXPR and print result\n"
                 "  -q SEXPR             evaluate SEXPR quietly\n"
+                "  -H MIB               heap ceiling in MiB\n"
+                "  -i IMAGE             map IMAGE saved by env:saveimg\n"
+                "  -p HEAPFILE          persistent heap, see env:ckpt\n"
                 "  src-file...          load source files\n";
 
             std::cout << helpmsg << std::endl;
@@ -87,6 +112,10 @@ auto repl(void *context, int argc, char **argv) -> void {
           case 'v':
             std::cout << libmu::api::mu_version() << std::endl;
             break;
+          case 'H': /* see heap_size */
+          case 'i': /* see main */
+          case 'p':
+            break;
           }
         }
 
@@ -101,6 +130,7 @@ auto repl(void *context, int argc, char **argv) -> void {
         if (feof(stdin))
           exit(0);
 
+        libmu::api::mu_idle(context);
         libmu::api::mu_writeln(
             context,
             libmu::api::mu_eval(context, libmu::api::mu_read_stream(
@@ -112,7 +142,21 @@ auto repl(void *context, int argc, char **argv) -> void {
 
 auto main(int argc, char *argv[]) -> int {
   auto ctx = libmu::api::mu_context(STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO,
-                                    argv, argc);
+                                    argv, argc, heap_size(argc, argv),
+                                    option(argc, argv, "-i"),
+                                    option(argc, argv, "-p"));
+
+  if (ctx == nullptr) {
+    auto heap_file = option(argc, argv, "-p");
+
+    if (heap_file == nullptr)
+      std::cerr << "unable to map image " << option(argc, argv, "-i")
+                << std::endl;
+    else
+      std::cerr << "unable to open heap file " << heap_file << std::endl;
+
+    exit(EXIT_FAILURE);
+  }
 
   repl(ctx, argc, argv);
   return EXIT_SUCCESS;